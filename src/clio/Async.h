@@ -0,0 +1,232 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "Clio.h"
+
+#if !__has_include(<coroutine>) || !defined(__cpp_impl_coroutine)
+#error "Clio/Async.h requires C++20 coroutine support"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <system_error>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// Asynchronous serialization: the serialization runs in a coroutine which suspends whenever the output sink has
+// accumulated more than it is willing to buffer, and is resumed by an event loop once the sink's descriptor is writable.
+//
+// A sink is any class that provides:
+//      std::size_t pending() const;        // The number of bytes buffered and not yet written out
+//      std::size_t flush();                // Writes out as much as possible without blocking, returns the number of bytes still pending
+//      std::size_t watermark() const;      // The number of pending bytes above which the producer should yield
+//      int descriptor() const;             // The (non-blocking) descriptor the sink writes to
+// The serializer is expected to append its output to the sink's buffer.
+namespace Clio::Async {
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() noexcept { return Task(handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct Awaiter {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(handle h) noexcept {
+                    auto continuation = h.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return Awaiter();
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+    };
+    using handle = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+    Task& operator = (Task&& other) noexcept {
+        std::swap(coroutine, other.coroutine);
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator = (const Task&) = delete;
+
+    ~Task() {
+        if (coroutine) coroutine.destroy();
+    }
+
+    bool done() const noexcept { return !coroutine || coroutine.done(); }
+    void resume() { coroutine.resume(); }
+    // Rethrows the exception the coroutine finished with (if any)
+    void result() const {
+        if (coroutine && coroutine.promise().exception) std::rethrow_exception(coroutine.promise().exception);
+    }
+
+    // Awaiting a task runs it to completion before the awaiting coroutine continues
+    bool await_ready() const noexcept { return done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        coroutine.promise().continuation = awaiting;
+        return coroutine;
+    }
+    void await_resume() const { result(); }
+
+private:
+    explicit Task(handle h) noexcept : coroutine(h) {}
+
+    handle coroutine;
+};
+
+namespace detail {
+class Tasks {
+public:
+    // Starts the task and keeps it alive until it completes
+    void spawn(Task task) {
+        task.resume();
+        if (!task.done()) tasks.push_back(std::move(task));
+        else task.result();
+    }
+
+    bool empty() const noexcept { return tasks.empty(); }
+
+protected:
+    // Drops the completed tasks, propagating the first failure
+    void reap() {
+        auto done = std::stable_partition(tasks.begin(), tasks.end(), [] (const Task& task) { return !task.done(); });
+        std::vector<Task> finished(std::make_move_iterator(done), std::make_move_iterator(tasks.end()));
+        tasks.erase(done, tasks.end());
+        for (auto& task : finished) task.result();
+    }
+
+    std::vector<Task> tasks;
+};
+}
+
+// Event loop over epoll; a suspended coroutine is resumed when its descriptor becomes writable.
+// Only one coroutine may wait on a given descriptor at a time.
+class EpollLoop : public detail::Tasks {
+public:
+    EpollLoop() : epoll(::epoll_create1(EPOLL_CLOEXEC)) {
+        if (epoll < 0) throw std::system_error(errno, std::generic_category(), "Can't create epoll instance");
+    }
+    EpollLoop(const EpollLoop&) = delete;
+    EpollLoop& operator = (const EpollLoop&) = delete;
+
+    ~EpollLoop() {
+        ::close(epoll);
+    }
+
+    auto writable(int descriptor) {
+        struct Awaiter {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { loop.watch(descriptor, h); }
+            void await_resume() const noexcept {}
+
+            EpollLoop& loop;
+            int descriptor;
+        };
+        return Awaiter { *this, descriptor };
+    }
+
+    // Waits up to timeout milliseconds (-1 for indefinitely) and resumes the coroutines whose descriptors became writable
+    std::size_t poll(int timeout = -1) {
+        epoll_event events[64];
+        int count = ::epoll_wait(epoll, events, std::size(events), timeout);
+        if (count < 0) {
+            if (errno == EINTR) return 0;
+            throw std::system_error(errno, std::generic_category(), "Can't wait for epoll events");
+        }
+        for (int i = 0; i < count; ++i) {
+            std::coroutine_handle<>::from_address(events[i].data.ptr).resume();
+        }
+        reap();
+        return static_cast<std::size_t>(count);
+    }
+
+    void run() {
+        while (!empty()) poll();
+    }
+
+private:
+    void watch(int descriptor, std::coroutine_handle<> h) {
+        // One-shot, so the descriptor is disarmed once it has fired and can be rearmed with EPOLL_CTL_MOD
+        epoll_event event {};
+        event.events = EPOLLOUT | EPOLLONESHOT;
+        event.data.ptr = h.address();
+        if (::epoll_ctl(epoll, EPOLL_CTL_MOD, descriptor, &event) == 0) return;
+        if (errno != ENOENT || ::epoll_ctl(epoll, EPOLL_CTL_ADD, descriptor, &event) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Can't watch descriptor");
+        }
+    }
+
+    int epoll;
+};
+
+// Event loop that treats every descriptor as writable on the next turn, resuming the waiting coroutines
+// in order. Suitable for tests and for interleaving streams into in-memory sinks.
+class LocalLoop : public detail::Tasks {
+public:
+    auto writable(int) {
+        struct Awaiter {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { loop.pending.push_back(h); }
+            void await_resume() const noexcept {}
+
+            LocalLoop& loop;
+        };
+        return Awaiter { *this };
+    }
+
+    std::size_t poll() {
+        std::size_t count = pending.size();
+        for (std::size_t i = 0; i < count; ++i) {
+            auto h = pending.front();
+            pending.pop_front();
+            h.resume();
+        }
+        reap();
+        return count;
+    }
+
+    void run() {
+        while (!empty()) poll();
+    }
+
+private:
+    std::deque<std::coroutine_handle<>> pending;
+};
+
+// Suspends until the sink has no more than threshold bytes pending
+template <typename Loop, typename Sink>
+Task drain(Loop& loop, Sink& sink, std::size_t threshold = 0) {
+    while (sink.flush() > threshold) {
+        co_await loop.writable(sink.descriptor());
+    }
+}
+
+// Serializes the container as an array, one element at a time, yielding to the loop whenever the sink is above its watermark.
+// The sink is flushed only once its watermark is exceeded, and once more at the end.
+// The serializer, sink and container are referenced and must outlive the task, the remaining arguments are copied into it.
+template <typename Loop, typename Sink, typename Interface, typename Container, typename ... Arguments>
+std::enable_if_t<is_serializer_v<Interface>, Task> serialize_sequence(Loop& loop, Sink& sink, Interface& s, const Container& v, Arguments ... args) {
+    {
+        auto array = s.array();
+        for (auto& item : v) {
+            array.value(item, args...);
+            if (sink.pending() > sink.watermark()) {
+                co_await drain(loop, sink, sink.watermark());
+            }
+        }
+    }
+    co_await drain(loop, sink);
+}
+}
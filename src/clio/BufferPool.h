@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace Clio {
+// Thread-local pool of output buffers, grouped in power of two size classes by capacity.
+// A serializer writes into a leased buffer which is handed over (moved) to the consumer; once the lease is destroyed the buffer,
+// with its capacity intact, goes back to the pool of the thread that releases it.
+template <typename Buffer = std::string>
+class BufferPool {
+public:
+    static constexpr std::size_t minimumCapacity = 256;
+    static constexpr std::size_t classes = 17;     // Up to minimumCapacity << 16 (16 MiB), larger buffers aren't retained
+    static constexpr std::size_t buffersPerClass = 16;
+
+    struct Statistics {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t retained = 0;   // Buffers held in the pool
+        std::size_t retainedBytes = 0;
+
+        double hitRate() const noexcept { return hits + misses ? double(hits) / double(hits + misses) : 0; }
+    };
+
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept : buffer(std::move(other.buffer)), owned(std::exchange(other.owned, false)) {}
+        Lease& operator = (Lease&& other) noexcept {
+            std::swap(buffer, other.buffer);
+            std::swap(owned, other.owned);
+            return *this;
+        }
+        Lease(const Lease&) = delete;
+        Lease& operator = (const Lease&) = delete;
+
+        ~Lease() {
+            if (owned) BufferPool::local().release(std::move(buffer));
+        }
+
+        Buffer& operator * () noexcept { return buffer; }
+        const Buffer& operator * () const noexcept { return buffer; }
+        Buffer* operator -> () noexcept { return &buffer; }
+        const Buffer* operator -> () const noexcept { return &buffer; }
+
+        // Takes the buffer out of the pool's management for good
+        Buffer detach() noexcept {
+            owned = false;
+            return std::move(buffer);
+        }
+
+    private:
+        friend BufferPool;
+        explicit Lease(Buffer&& b) noexcept : buffer(std::move(b)), owned(true) {}
+
+        Buffer buffer;
+        bool owned = false;
+    };
+
+    BufferPool() {
+        for (auto& free : freeLists) free.reserve(buffersPerClass);
+    }
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator = (const BufferPool&) = delete;
+
+    // Leases an empty buffer with a capacity of at least the given size
+    Lease acquire(std::size_t capacity = minimumCapacity) {
+        for (std::size_t index = sizeClass(capacity); index < classes; ++index) {
+            auto& free = freeLists[index];
+            if (free.empty()) continue;
+
+            Buffer buffer = std::move(free.back());
+            free.pop_back();
+            stats.hits++;
+            stats.retained--;
+            stats.retainedBytes -= buffer.capacity();
+            return Lease(std::move(buffer));
+        }
+
+        // Round up to the size class, so the buffer is found again by the same request once it's returned
+        stats.misses++;
+        std::size_t index = sizeClass(capacity);
+        Buffer buffer;
+        buffer.reserve(index < classes ? minimumCapacity << index : capacity);
+        return Lease(std::move(buffer));
+    }
+
+    // Returns a buffer to the pool, it's dropped if the pool is full or the buffer is too large to keep
+    void release(Buffer&& buffer) {
+        std::size_t capacity = buffer.capacity();
+        if (capacity < minimumCapacity) return;
+        // File the buffer under the largest class it fully covers, buffers beyond the largest class are dropped
+        std::size_t index = sizeClass(capacity);
+        if (index >= classes) return;
+        if ((minimumCapacity << index) > capacity) index--;
+        if (freeLists[index].size() >= buffersPerClass) return;
+
+        buffer.clear();
+        freeLists[index].push_back(std::move(buffer));
+        stats.retained++;
+        stats.retainedBytes += capacity;
+    }
+
+    const Statistics& statistics() const noexcept { return stats; }
+
+    // Frees the retained buffers
+    void trim() noexcept {
+        for (auto& free : freeLists) free.clear();
+        stats.retained = stats.retainedBytes = 0;
+    }
+
+    static BufferPool& local() {
+        thread_local BufferPool pool;
+        return pool;
+    }
+
+private:
+    static std::size_t sizeClass(std::size_t capacity) noexcept {
+        std::size_t index = 0;
+        while (index < classes && (minimumCapacity << index) < capacity) ++index;
+        return index;
+    }
+
+    std::array<std::vector<Buffer>, classes> freeLists;
+    Statistics stats;
+};
+}
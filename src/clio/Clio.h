@@ -5,6 +5,12 @@
 
 #include <type_traits>
 
+// Capability detection uses requires-expressions when available, which is considerably cheaper to compile
+// than the void_t based detection idiom. Define CLIO_NO_CONCEPTS to force the C++17 code path.
+#if !defined(CLIO_NO_CONCEPTS) && defined(__cpp_concepts) && __cpp_concepts >= 201907L
+#define CLIO_HAS_CONCEPTS
+#endif
+
 #define CLIO_SERIALIZER(Name) \
     friend Clio::Serialization::Node<Name>; \
     friend Clio::Serialization::Object<Name>; \
@@ -67,6 +73,10 @@ inline constexpr bool is_instantiation_of_v = is_instantiation_of<Template, remo
 template <typename Head, typename ... Tail>
 struct pack {};
 
+// Keys passed as constant character arrays, usually literals, which keep their address from one call to the next
+template <typename Key>
+inline constexpr bool is_literal_key_v = std::is_array_v<std::remove_reference_t<Key>> && std::is_same_v<std::remove_extent_t<std::remove_reference_t<Key>>, const char>;
+
 template <typename Type>
 inline constexpr bool is_serializer_v = std::is_base_of_v<Serializer<Type>, Type>;
 template <typename Type>
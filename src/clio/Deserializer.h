@@ -3,10 +3,64 @@
 
 #pragma once
 #include "Clio.h"
+#include "Error.h"
 #include <utility>
 #include <optional>
+#include <vector>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace Clio {
+// What the next value in the input is, for backends that can tell (see Transcoder.h)
+enum class Kind {
+    Null,
+    Bool,
+    Integer,
+    Unsigned,
+    Floating,
+    String,
+    Blob,
+    Object,
+    Array
+};
+}
 
 namespace Clio::Deserialization {
+// Remembers at which position each field of an object was found, keyed by the order in which the fields are requested.
+// Objects of the same type usually come from the same serialize() function, so when the n-th requested key is the very same
+// literal (pointer and length) as the last time, the backend is pointed directly at the position it was found before.
+// Other keys aren't predicted, as a different string may take the place of one that's gone.
+class Shape {
+public:
+    static constexpr std::size_t npos = ~std::size_t(0);
+
+    std::size_t predict(std::size_t field, std::string_view key) const noexcept {
+        if (field >= fields.size()) return npos;
+        const Field& f = fields[field];
+        return f.key.data() == key.data() && f.key.size() == key.size() ? f.position : npos;
+    }
+
+    void learn(std::size_t field, std::string_view key, std::size_t position) {
+        if (field >= fields.size()) fields.resize(field + 1);
+        fields[field] = { key, position };
+    }
+
+private:
+    struct Field {
+        std::string_view key;
+        std::size_t position = npos;
+    };
+    std::vector<Field> fields;
+};
+
+// The shape cache for objects of the given type, shared by all the deserializers on the current thread
+template <typename Type>
+Shape& shape() {
+    thread_local Shape instance;
+    return instance;
+}
+
 template <typename Interface>
 struct Node : Clio::Node<Interface> {
     using Base = Clio::Node<Interface>;
@@ -15,6 +69,7 @@ struct Node : Clio::Node<Interface> {
 protected:
     template <typename ValueType>
     void value(ValueType& v) {
+        if (skipping()) return;
         if constexpr (has_global_read<ValueType>()) {
             deserialize(this->node, v);
         }
@@ -28,6 +83,7 @@ protected:
 
     template <typename ValueType, typename Head, typename ... Tail>
     void value(ValueType& v, Head&& head, Tail&& ... tail) {
+        if (skipping()) return;
         if constexpr (std::is_invocable_v<Head, Interface&, ValueType&, Tail...>) {
             std::forward<Head>(head)(this->node, v, std::forward<Tail>(tail)...);
         }
@@ -42,7 +98,117 @@ protected:
         }
     }
 
+    // In the error recording mode nothing more is read from the backend once an error has been recorded
+    bool skipping() const noexcept {
+        if constexpr (records_errors_v<Interface>) {
+            return this->node.failed();
+        }
+        else {
+            return false;
+        }
+    }
+
+    // With a key dictionary (see KeyDictionary.h) the backend works with ids only. Literal keys are resolved through the
+    // dictionary's cache, the others are looked up on each call
+    template <typename Key>
+    void deserializeKey(Key&& key) {
+        if (skipping()) return;
+        if constexpr (has_key_dictionary()) {
+            this->node.readKey(this->node.keyDictionary().find(key));
+        }
+        else {
+            this->node.readKey(std::forward<Key>(key));
+        }
+    }
+
+    // Backends that accept a position hint, std::size_t readKey(Key, std::size_t position), are expected to check the key at
+    // the given position first (Shape::npos if there's no prediction), fall back to a search and return the position found
+    template <typename Key>
+    void deserializeKey(Key&& key, Shape& shape, std::size_t field) {
+        if (skipping()) return;
+        if constexpr (has_key_dictionary()) {
+            readShapedKey<Key>(this->node.keyDictionary().find(key), key, shape, field);
+        }
+        else {
+            readShapedKey<Key>(std::string_view(key), key, shape, field);
+        }
+    }
+
+    template <typename Key>
+    bool containsKey(Key&& key) const {
+        if (skipping()) return false;
+        if constexpr (has_key_dictionary()) {
+            return this->node.hasKey(this->node.keyDictionary().find(key));
+        }
+        else {
+            return this->node.hasKey(key);
+        }
+    }
+
+    // Backends that implement Kind kind() const report the next value: the root at the top level, the next element in
+    // an array, or the value of the key peekKey() returns in an object
+    Kind nextKind() const {
+        return skipping() ? Kind::Null : this->node.kind();
+    }
+
+    auto nextKey() const {
+        if constexpr (has_key_dictionary()) {
+            auto& dictionary = this->node.keyDictionary();
+            using Key = remove_cvref_t<decltype(dictionary.key(0))>;
+            if (skipping()) return Key();
+            auto id = this->node.peekKey();
+            if (dictionary.contains(id)) return Key(dictionary.key(id));
+            detail::fail(this->node, errc::invalid_data, [id] () { return "Undefined key id: " + std::to_string(id); });
+            return Key();
+        }
+        else {
+            using Key = remove_cvref_t<decltype(this->node.peekKey())>;
+            if (skipping()) return Key();
+            return Key(this->node.peekKey());
+        }
+    }
+
 private:
+    template <typename Key, typename Name>
+    void readShapedKey(const Name& name, std::string_view key, Shape& shape, std::size_t field) {
+        if constexpr (!has_hinted_read_key<Name>()) {
+            this->node.readKey(name);
+        }
+        else if constexpr (!is_literal_key_v<Key>) {
+            this->node.readKey(name, Shape::npos);
+        }
+        else {
+            std::size_t predicted = shape.predict(field, key);
+            std::size_t position = this->node.readKey(name, predicted);
+            if (position != predicted && !skipping()) shape.learn(field, key, position);
+        }
+    }
+
+#ifdef CLIO_HAS_CONCEPTS
+    static constexpr bool has_key_dictionary() {
+        return requires (Interface& node) { node.keyDictionary(); };
+    }
+    template <typename Name>
+    static constexpr bool has_hinted_read_key() {
+        return requires (Interface& node, const Name& name) { static_cast<std::size_t>(node.readKey(name, std::size_t())); };
+    }
+    template <typename Type, typename ... Arguments>
+    static constexpr bool has_internal_read() {
+        return requires (Interface& node, Type& v) { node.read(v, std::declval<remove_cvref_t<Arguments>>()...); };
+    }
+    template <typename Type, typename ... Arguments>
+    static constexpr bool has_global_read() {
+        if constexpr (!is_primitive_v<Type> || sizeof...(Arguments) > 0) {
+            return requires (Interface& node, remove_cvref_t<Type>& v) { deserialize(node, v, std::declval<Arguments>()...); };
+        }
+        else {
+            return false;
+        }
+    }
+#else
+    static constexpr bool has_key_dictionary() { return traits::template has_key_dictionary<Interface>::value; }
+    template <typename Name>
+    static constexpr bool has_hinted_read_key() { return traits::template has_hinted_read_key<Name>::value; }
     template <typename Type, typename ... Arguments>
     static constexpr bool has_internal_read() { return traits::template has_internal_read<pack<Type, Arguments...>>::value; }
     template <typename Type, typename ... Arguments>
@@ -67,7 +233,18 @@ private:
         struct has_global_read : std::false_type {};
         template <typename Type, typename ... Arguments>
         struct has_global_read<pack<Type, Arguments...>, global_read_trait<remove_cvref_t<Type>, Arguments...>> : std::true_type {};
+
+        template <typename, typename = void>
+        struct has_key_dictionary : std::false_type {};
+        template <typename Type>
+        struct has_key_dictionary<Type, std::void_t<decltype(std::declval<Type&>().keyDictionary())>> : std::true_type {};
+
+        template <typename, typename = void>
+        struct has_hinted_read_key : std::false_type {};
+        template <typename Name>
+        struct has_hinted_read_key<Name, std::void_t<decltype(static_cast<std::size_t>(std::declval<Interface&>().readKey(std::declval<const Name&>(), std::size_t())))>> : std::true_type {};
     };
+#endif
 };
 
 template <typename Interface>
@@ -75,43 +252,53 @@ struct Object : Node<Interface> {
     using Base = Node<Interface>;
 
     Object(Interface& parent) : Base(parent) {
-        this->node.beginObject();
+        if (!this->skipping()) this->node.beginObject();
+    }
+
+    Object(Interface& parent, Shape& s) : Object(parent) {
+        shape = &s;
     }
 
     ~Object() {
-        this->node.endObject();
+        if (!this->skipping()) this->node.endObject();
     }
 
     auto peekKey() const {
-        return this->node.peekKey();
+        return this->nextKey();
     }
 
     template <typename Key>
-    bool hasKey(const Key& key) {
-        return this->node.hasKey(key);
+    bool hasKey(Key&& key) {
+        return this->containsKey(key);
     }
 
     template <typename Key, typename Type = Object<Interface>>
     auto object(Key&& key) {
-        this->node.readKey(std::forward<Key>(key));
+        readKey(std::forward<Key>(key));
         return Type(this->node);
     }
 
+    template <typename Key, typename Type = Object<Interface>>
+    auto object(Key&& key, Shape& s) {
+        readKey(std::forward<Key>(key));
+        return Type(this->node, s);
+    }
+
     template <typename Key, typename Type = Array<Interface>>
     auto array(Key&& key) {
-        this->node.readKey(std::forward<Key>(key));
+        readKey(std::forward<Key>(key));
         return Type(this->node);
     }
 
     template <typename Key, typename Type = Blob<Interface>>
     auto blob(Key&& key) {
-        this->node.readKey(std::forward<Key>(key));
+        readKey(std::forward<Key>(key));
         return Type(this->node);
     }
 
     template <typename Key, typename ValueType, typename ... Arguments>
     std::enable_if_t<(!is_instantiation_of_v<std::optional, ValueType>)> value(Key&& key, ValueType& v, Arguments&& ... args) {
-        this->node.readKey(std::forward<Key>(key));
+        readKey(std::forward<Key>(key));
         Base::value(v, std::forward<Arguments>(args)...);
     }
 
@@ -130,7 +317,22 @@ struct Object : Node<Interface> {
     }
 
     auto empty() const { return !size(); }
-    auto size() const { return this->node.size(); }
+    auto size() const { return this->skipping() ? decltype(this->node.size())() : this->node.size(); }
+    Kind valueKind() const { return this->nextKind(); }
+
+private:
+    template <typename Key>
+    void readKey(Key&& key) {
+        if (shape) {
+            this->deserializeKey(key, *shape, field++);
+        }
+        else {
+            this->deserializeKey(std::forward<Key>(key));
+        }
+    }
+
+    Shape* shape = nullptr;
+    std::size_t field = 0;
 };
 
 template <typename Interface>
@@ -139,22 +341,67 @@ struct Array : Node<Interface> {
     using Base::value;
 
     Array(Interface& parent) : Base(parent) {
-        this->node.beginArray();
+        if (!this->skipping()) this->node.beginArray();
     }
 
     ~Array() {
-        this->node.endArray();
+        if (!this->skipping()) this->node.endArray();
     }
 
     template <typename Type = Object<Interface>>
     auto object() { return Type(this->node); }
+    template <typename Type = Object<Interface>>
+    auto object(Shape& s) { return Type(this->node, s); }
     template <typename Type = Array<Interface>>
     auto array() { return Type(this->node); }
     template <typename Type = Blob<Interface>>
     auto blob() { return Type(this->node); }
 
     auto empty() const { return !size(); }
-    auto size() const { return this->node.size(); }
+    auto size() const { return this->skipping() ? decltype(this->node.size())() : this->node.size(); }
+    Kind valueKind() const { return this->nextKind(); }
+
+    // Random access, for backends that can position themselves at an element (e.g. through an offset table) with seek(std::size_t).
+    // Reading continues sequentially from the sought element. An index past the end is reported as errc::out_of_range.
+    void seek(std::size_t index) {
+        if (this->skipping()) return;
+        std::size_t count = this->node.size();
+        if (index < count) {
+            this->node.seek(index);
+            return;
+        }
+        detail::fail(this->node, errc::out_of_range, [index, count] () {
+            return "Array index " + std::to_string(index) + " out of range, the size is " + std::to_string(count);
+        });
+    }
+
+    template <typename ValueType, typename ... Arguments>
+    ValueType at(std::size_t index, Arguments&& ... args) {
+        seek(index);
+        ValueType v {};
+        value(v, std::forward<Arguments>(args)...);
+        return v;
+    }
+
+    // Binary search over an array sorted with respect to compare, returns the index of the first element not less than needle.
+    // Returns the size of the array (as for a needle past the last element) if reading an element fails.
+    template <typename ValueType, typename Needle, typename Compare = std::less<>>
+    std::size_t lower_bound(const Needle& needle, Compare compare = Compare()) {
+        std::size_t first = 0, count = size(), end = count;
+        while (count > 0) {
+            std::size_t step = count / 2, middle = first + step;
+            ValueType v = at<ValueType>(middle);
+            if (this->skipping()) return end;
+            if (compare(v, needle)) {
+                first = middle + 1;
+                count -= step + 1;
+            }
+            else {
+                count = step;
+            }
+        }
+        return first;
+    }
 };
 
 template <typename Interface>
@@ -163,11 +410,11 @@ struct Blob : Node<Interface> {
     using Base::value;
 
     Blob(Interface& parent) : Base(parent) {
-        this->node.beginBlob();
+        if (!this->skipping()) this->node.beginBlob();
     }
 
     ~Blob() {
-        this->node.endBlob();
+        if (!this->skipping()) this->node.endBlob();
     }
 };
 }
@@ -182,16 +429,31 @@ struct Deserializer : Deserialization::Node<Interface> {
 
     template <typename Type = Deserialization::Object<Interface>>
     auto object() { return Type(this->node); }
+    template <typename Type = Deserialization::Object<Interface>>
+    auto object(Deserialization::Shape& s) { return Type(this->node, s); }
     template <typename Type = Deserialization::Array<Interface>>
     auto array() { return Type(this->node); }
     template <typename Type = Deserialization::Blob<Interface>>
     auto blob() { return Type(this->node); }
 
+    Kind valueKind() const { return this->nextKind(); }
+
     template <typename ValueType, typename ... Arguments>
     ValueType root(Arguments&& ... args) {
         ValueType v;
         value(v, std::forward<Arguments>(args)...);
         return v;
     }
+
+    // The first error recorded, see Error.h for the error reporting modes
+    const std::error_code& error() const noexcept { return status; }
+    bool failed() const noexcept { return static_cast<bool>(status); }
+
+    void fail(std::error_code code) noexcept {
+        if (!status) status = code;
+    }
+
+private:
+    std::error_code status;
 };
 }
@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "Clio.h"
+#include <string>
+#include <stdexcept>
+#include <utility>
+#include <system_error>
+
+namespace Clio {
+enum class errc {
+    size_mismatch = 1,  // A fixed-size container, tuple or map entry got the wrong number of elements
+    missing_key,
+    type_mismatch,
+    invalid_data,
+    unexpected_end,
+    out_of_range        // An array element that doesn't exist was requested
+};
+
+inline const std::error_category& error_category() noexcept {
+    struct Category : std::error_category {
+        const char* name() const noexcept override { return "clio"; }
+        std::string message(int code) const override {
+            switch (static_cast<errc>(code)) {
+            case errc::size_mismatch:
+                return "size mismatch";
+            case errc::missing_key:
+                return "missing key";
+            case errc::type_mismatch:
+                return "type mismatch";
+            case errc::invalid_data:
+                return "invalid data";
+            case errc::unexpected_end:
+                return "unexpected end of data";
+            case errc::out_of_range:
+                return "index out of range";
+            }
+            return "unknown error";
+        }
+    };
+    static const Category category;
+    return category;
+}
+
+inline std::error_code make_error_code(errc e) noexcept {
+    return { static_cast<int>(e), error_category() };
+}
+
+// How deserialization errors are reported. By default they're thrown, while a backend that declares
+// `using error_mode = Clio::ErrorMode::Record;` has the first error recorded in the deserializer instead, after which
+// the remaining reads are skipped and the result is checked once at the end through error().
+namespace ErrorMode {
+struct Throw {};
+struct Record {};
+}
+
+template <typename Interface, typename = void>
+struct error_mode {
+    using type = ErrorMode::Throw;
+};
+template <typename Interface>
+struct error_mode<Interface, std::void_t<typename Interface::error_mode>> {
+    using type = typename Interface::error_mode;
+};
+template <typename Interface>
+inline constexpr bool records_errors_v = std::is_same_v<typename error_mode<Interface>::type, ErrorMode::Record>;
+}
+
+template <>
+struct std::is_error_code_enum<Clio::errc> : std::true_type {};
+
+namespace Clio::detail {
+// -- Error reporting, either thrown or recorded in the deserializer depending on its error mode
+
+template <typename Interface>
+bool failed(const Interface& d) noexcept {
+    if constexpr (records_errors_v<Interface>) {
+        return d.failed();
+    }
+    else {
+        return false;
+    }
+}
+
+template <typename Interface, typename Message>
+void fail(Interface& d, errc code, Message&& message) {
+    if constexpr (records_errors_v<Interface>) {
+        d.fail(code);
+    }
+    else {
+        throw std::runtime_error(std::forward<Message>(message)());
+    }
+}
+}
@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace Clio {
+// Stream-level table of shared objects (see helper/memory.h). The serializer assigns ids to the pointees in order of first
+// appearance and writes repeated ones as references, the deserializer keeps the objects it has created so references to
+// them share ownership again. As with the key dictionary both sides keep their table for the whole stream, and clear it
+// together (e.g. between independent documents).
+class Identities {
+public:
+    using Id = std::uint32_t;
+
+    // Returns the object's id and whether it was newly added. The table shares the ownership of the objects it lists,
+    // so their addresses can't be taken over by other objects, and tells them apart by address and type, as a base
+    // subobject or an aliasing pointer may have the same address as a different object
+    template <typename Type>
+    std::pair<Id, bool> insert(const std::shared_ptr<Type>& object) {
+        auto [found, added] = ids.emplace(Key { object.get(), typeid(Type) }, static_cast<Id>(objects.size()));
+        if (added) objects.push_back({ object, &typeid(Type) });
+        return { found->second, added };
+    }
+
+    // Ids are expected in order of first appearance, returns false otherwise
+    template <typename Type>
+    bool define(Id id, const std::shared_ptr<Type>& object) {
+        if (id != objects.size()) return false;
+        objects.push_back({ object, &typeid(Type) });
+        return true;
+    }
+
+    // Returns nullptr if the id wasn't defined, or was defined for an object of a different type
+    template <typename Type>
+    std::shared_ptr<Type> find(Id id) const {
+        if (id >= objects.size() || *objects[id].type != typeid(Type)) return nullptr;
+        return std::const_pointer_cast<Type>(std::static_pointer_cast<const Type>(objects[id].object));
+    }
+
+    std::size_t size() const noexcept { return objects.size(); }
+
+    void clear() noexcept {
+        ids.clear();
+        objects.clear();
+    }
+
+private:
+    struct Key {
+        const void* address;
+        std::type_index type;
+
+        bool operator == (const Key& other) const noexcept { return address == other.address && type == other.type; }
+    };
+    struct Hash {
+        std::size_t operator () (const Key& key) const noexcept {
+            return std::hash<const void*>()(key.address) ^ (key.type.hash_code() * 31);
+        }
+    };
+    struct Entry {
+        std::shared_ptr<const void> object;
+        const std::type_info* type;
+    };
+
+    std::unordered_map<Key, Id, Hash> ids;
+    std::vector<Entry> objects;
+};
+}
@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "Clio.h"
+#include <array>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+
+namespace Clio {
+// Stream-level table of object keys. Ids are assigned in order of first appearance, so a serializer and a deserializer
+// which insert the keys in stream order agree on them without the table itself being transmitted.
+class KeyDictionary {
+public:
+    using Id = std::uint32_t;
+    static constexpr Id npos = ~Id(0);
+
+    // Returns the key's id and whether it was newly added
+    std::pair<Id, bool> insert(std::string_view key) {
+        auto found = ids.find(key);
+        if (found != ids.end()) return { found->second, false };
+
+        Id id = static_cast<Id>(keys.size());
+        const std::string& stored = keys.emplace_back(key);
+        ids.emplace(stored, id);
+        return { id, true };
+    }
+
+    // Returns the key's id, or npos if it hasn't been seen
+    Id find(std::string_view key) const noexcept {
+        auto found = ids.find(key);
+        return found != ids.end() ? found->second : npos;
+    }
+
+    // Keys passed as constant character arrays, usually literals, are remembered by their address once resolved, so the
+    // following lookups from the same call site don't hash the key. The address alone doesn't identify the key, a local
+    // array may be at the address of another one that's gone, so a hit is confirmed by comparing the text with the
+    // dictionary's. Other keys are looked up as above.
+    template <typename Key>
+    std::pair<Id, bool> insert(Key&& key) {
+        if constexpr (is_literal_key_v<Key>) {
+            std::string_view text(key);
+            Literal& literal = cached(text.data());
+            if (matches(literal, text)) return { literal.id, false };
+            auto result = insert(text);
+            literal = { text.data(), result.first };
+            return result;
+        }
+        else {
+            return insert(std::string_view(key));
+        }
+    }
+
+    template <typename Key>
+    Id find(Key&& key) const noexcept {
+        if constexpr (is_literal_key_v<Key>) {
+            std::string_view text(key);
+            Literal& literal = cached(text.data());
+            if (matches(literal, text)) return literal.id;
+            Id id = find(text);
+            if (id != npos) literal = { text.data(), id };
+            return id;
+        }
+        else {
+            return find(std::string_view(key));
+        }
+    }
+
+    bool contains(Id id) const noexcept { return id < keys.size(); }
+    const std::string& key(Id id) const { return keys.at(id); }
+
+    std::size_t size() const noexcept { return keys.size(); }
+    bool empty() const noexcept { return keys.empty(); }
+
+    void clear() noexcept {
+        ids.clear();
+        keys.clear();
+        literals.fill(Literal());
+    }
+
+private:
+    struct Literal {
+        const char* key = nullptr;
+        Id id = npos;
+    };
+
+    bool matches(const Literal& literal, std::string_view key) const noexcept {
+        return literal.key == key.data() && keys[literal.id] == key;
+    }
+
+    Literal& cached(const char* key) const noexcept {
+        auto address = reinterpret_cast<std::uintptr_t>(key);
+        return literals[(address ^ (address >> 7)) % literals.size()];
+    }
+
+    std::deque<std::string> keys;   // Stable addresses, the views in ids refer to them
+    std::unordered_map<std::string_view, Id> ids;
+    mutable std::array<Literal, 64> literals {};    // Direct-mapped by the literal's address
+};
+}
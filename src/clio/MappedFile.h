@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Clio {
+// Read-only memory mapping of a file, to be handed to a deserializer as its input without copying.
+// The mapped bytes stay valid for the lifetime of the object, so any views a backend hands out
+// (e.g. through read(std::string_view&)) must not outlive it.
+class MappedFile {
+public:
+    enum class Access { Sequential, Random };
+
+    explicit MappedFile(const std::string& path, Access access = Access::Sequential) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            int error = errno;
+            fail("Can't open " + path, error);
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            int error = errno;
+            ::close(fd);
+            fail("Can't stat " + path, error);
+        }
+
+        length = static_cast<std::size_t>(info.st_size);
+        if (length > 0) {
+            void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                fail("Can't map " + path, error);
+            }
+            bytes = static_cast<const char*>(address);
+            advise(access);
+        }
+        ::close(fd);    // The mapping holds its own reference to the file
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : bytes(std::exchange(other.bytes, nullptr)), length(std::exchange(other.length, 0)) {}
+    MappedFile& operator = (MappedFile&& other) noexcept {
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        return *this;
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (bytes) ::munmap(const_cast<char*>(bytes), length);
+    }
+
+    const char* data() const noexcept { return bytes; }
+    std::size_t size() const noexcept { return length; }
+    bool empty() const noexcept { return !length; }
+
+    std::string_view view() const noexcept { return { bytes, length }; }
+    operator std::string_view() const noexcept { return view(); }
+
+private:
+    void advise(Access access) noexcept {
+        // Hints only, failures are harmless
+        void* address = const_cast<char*>(bytes);
+        if (access == Access::Sequential) {
+            ::madvise(address, length, MADV_SEQUENTIAL);
+            ::madvise(address, length, MADV_WILLNEED);
+        }
+        else {
+            ::madvise(address, length, MADV_RANDOM);
+        }
+    }
+
+    [[noreturn]] static void fail(const std::string& what, int error) {
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    const char* bytes = nullptr;
+    std::size_t length = 0;
+};
+}
@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <sys/uio.h>
+
+namespace Clio {
+// Serializer output as a list of segments, ready for writev()/sendmsg(). Small writes are copied into an internal buffer,
+// while payloads of at least threshold() bytes passed to reference() are recorded by address instead of being copied.
+//
+// Lifetime: referenced bytes belong to the caller, who must keep them alive and unmodified until the output has been
+// written out (i.e. until consume() has gone past them, or clear() is called). The values a serializer is given are
+// guaranteed only for the duration of the write, the helpers pass strings they reuse (e.g. Clio::Packed and the
+// transcoder), so a backend should copy them with append() and reference only storage the application vouches for
+// (e.g. through a type of its own). The vectors returned by iovecs() are invalidated by any modification of the buffer.
+class SegmentBuffer {
+public:
+    static constexpr std::size_t defaultThreshold = 16 * 1024;
+
+    explicit SegmentBuffer(std::size_t threshold = defaultThreshold) : minimum(threshold) {}
+
+    void append(std::string_view bytes) {
+        if (bytes.empty()) return;
+        if (segments.empty() || segments.back().data) {
+            segments.push_back({ nullptr, owned.size(), 0 });
+        }
+        owned.append(bytes.data(), bytes.size());
+        segments.back().size += bytes.size();
+        total += bytes.size();
+    }
+
+    void append(char byte) {
+        append(std::string_view(&byte, 1));
+    }
+
+    // References the bytes when they're large enough, copies them otherwise
+    void reference(std::string_view bytes) {
+        if (bytes.size() < minimum) {
+            append(bytes);
+            return;
+        }
+        segments.push_back({ bytes.data(), 0, bytes.size() });
+        total += bytes.size();
+    }
+
+    std::size_t threshold() const noexcept { return minimum; }
+    void setThreshold(std::size_t threshold) noexcept { minimum = threshold; }
+
+    // Bytes not yet consumed
+    std::size_t size() const noexcept { return total; }
+    bool empty() const noexcept { return !total; }
+
+    // The pending segments, at most limit of them (writev() accepts up to IOV_MAX)
+    const std::vector<iovec>& iovecs(std::size_t limit = ~std::size_t(0)) {
+        vectors.clear();
+        for (std::size_t i = first; i < segments.size() && vectors.size() < limit; ++i) {
+            const Segment& segment = segments[i];
+            const char* data = segment.data ? segment.data : owned.data() + segment.offset;
+            std::size_t skip = i == first ? consumed : 0;
+            vectors.push_back({ const_cast<char*>(data + skip), segment.size - skip });
+        }
+        return vectors;
+    }
+
+    // Marks the given number of bytes as written, e.g. after a partial writev(). Check the result for errors first, as
+    // -1 converted to std::size_t consumes everything.
+    void consume(std::size_t bytes) noexcept {
+        total -= bytes < total ? bytes : total;
+        while (bytes > 0 && first < segments.size()) {
+            std::size_t left = segments[first].size - consumed;
+            if (bytes < left) {
+                consumed += bytes;
+                return;
+            }
+            bytes -= left;
+            consumed = 0;
+            first++;
+        }
+        if (first == segments.size()) clear();
+    }
+
+    // Copies the pending output into a contiguous string
+    std::string flatten() const {
+        std::string result;
+        result.reserve(total);
+        for (std::size_t i = first; i < segments.size(); ++i) {
+            const Segment& segment = segments[i];
+            const char* data = segment.data ? segment.data : owned.data() + segment.offset;
+            std::size_t skip = i == first ? consumed : 0;
+            result.append(data + skip, segment.size - skip);
+        }
+        return result;
+    }
+
+    // Drops everything, keeping the allocated capacity
+    void clear() noexcept {
+        owned.clear();
+        segments.clear();
+        first = consumed = total = 0;
+    }
+
+private:
+    struct Segment {
+        const char* data;       // Referenced bytes, or nullptr for the internal buffer
+        std::size_t offset;     // Into the internal buffer, which may be reallocated while appending
+        std::size_t size;
+    };
+
+    std::string owned;
+    std::vector<Segment> segments;
+    std::vector<iovec> vectors;
+    std::size_t minimum;
+    std::size_t first = 0, consumed = 0, total = 0;
+};
+}
@@ -5,6 +5,7 @@
 #include "Clio.h"
 #include <utility>
 #include <optional>
+#include <string_view>
 
 namespace Clio::Serialization {
 template <typename Interface>
@@ -62,7 +63,50 @@ protected:
         }
     }
 
+    // With a key dictionary (see KeyDictionary.h) the first occurrence of a key is defined and later ones are written as its id.
+    // Literal keys are resolved through the dictionary's cache
+    template <typename Key>
+    void serializeKey(Key&& key) {
+        if constexpr (has_key_dictionary()) {
+            auto [id, added] = this->node.keyDictionary().insert(key);
+            if (added) {
+                this->node.defineKey(id, std::string_view(key));
+            }
+            else {
+                this->node.writeKey(id);
+            }
+        }
+        else {
+            this->node.writeKey(std::forward<Key>(key));
+        }
+    }
+
 private:
+#ifdef CLIO_HAS_CONCEPTS
+    static constexpr bool has_key_dictionary() {
+        return requires (Interface& node) { node.keyDictionary(); };
+    }
+    template <typename Type, typename ... Arguments>
+    static constexpr bool has_internal_write() {
+        using Node = remove_cvref_t<Interface>;
+        if constexpr (is_primitive_v<Type>) {
+            return requires { static_cast<void(Node::*)(remove_cvref_t<Type>)>(&Node::write); };
+        }
+        else {
+            return requires (Interface& node) { node.write(std::declval<remove_cvref_t<Type>>(), std::declval<remove_cvref_t<Arguments>>()...); };
+        }
+    }
+    template <typename Type, typename ... Arguments>
+    static constexpr bool has_global_write() {
+        if constexpr (!is_primitive_v<Type> || sizeof...(Arguments) > 0) {
+            return requires (Interface& node) { serialize(node, std::declval<remove_cvref_t<Type>>(), std::declval<Arguments>()...); };
+        }
+        else {
+            return false;
+        }
+    }
+#else
+    static constexpr bool has_key_dictionary() { return traits::template has_key_dictionary<Interface>::value; }
     template <typename Type, typename ... Arguments>
     static constexpr bool has_internal_write() { return traits::template has_primitive_write<Type>::value || traits::template has_class_write<Type, Arguments...>::value; }
     template <typename Type, typename ... Arguments>
@@ -98,7 +142,13 @@ private:
         struct has_global_write : std::false_type {};
         template <typename Type, typename ... Arguments>
         struct has_global_write<pack<Type, Arguments...>, global_write_trait<remove_cvref_t<Type>, Arguments...>> : std::true_type {};
+
+        template <typename, typename = void>
+        struct has_key_dictionary : std::false_type {};
+        template <typename Type>
+        struct has_key_dictionary<Type, std::void_t<decltype(std::declval<Type&>().keyDictionary())>> : std::true_type {};
     };
+#endif
 };
 
 template <typename Interface>
@@ -115,37 +165,37 @@ struct Object : Node<Interface> {
 
     template <typename Key, typename Type = Object<Interface>>
     auto object(Key&& key) {
-        this->node.writeKey(std::forward<Key>(key));
+        this->serializeKey(std::forward<Key>(key));
         return Type(this->node);
     }
 
     template <typename Key, typename Type = Array<Interface>>
     auto array(Key&& key) {
-        this->node.writeKey(std::forward<Key>(key));
+        this->serializeKey(std::forward<Key>(key));
         return Type(this->node);
     }
 
     template <typename Key, typename Type = Blob<Interface>>
     auto blob(Key&& key) {
-        this->node.writeKey(std::forward<Key>(key));
+        this->serializeKey(std::forward<Key>(key));
         return Type(this->node);
     }
 
     template <typename Key, typename ValueType>
     std::enable_if_t<is_primitive_v<ValueType>> value(Key&& key, ValueType v) {
-        this->node.writeKey(std::forward<Key>(key));
+        this->serializeKey(std::forward<Key>(key));
         Base::value(v);
     }
 
     template <typename Key, typename ValueType, typename Functor>
     std::enable_if_t<is_primitive_v<ValueType>> value(Key&& key, ValueType v, Functor f) {
-        this->node.writeKey(std::forward<Key>(key));
+        this->serializeKey(std::forward<Key>(key));
         Base::value(v, std::forward<Functor>(f));
     }
 
     template <typename Key, typename ValueType, typename ... Arguments>
     std::enable_if_t<(!is_primitive_v<ValueType> && !is_instantiation_of_v<std::optional, ValueType>)> value(Key&& key, const ValueType& v, Arguments&& ... args) {
-        this->node.writeKey(std::forward<Key>(key));
+        this->serializeKey(std::forward<Key>(key));
         Base::value(v, std::forward<Arguments>(args)...);
     }
 
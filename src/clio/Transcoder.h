@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "Clio.h"
+#include "Serializer.h"
+#include "Deserializer.h"
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace Clio {
+// Converts a document from one format into another in a single pass, without the C++ types it was written from.
+// The source backend has to implement Kind kind() const (see Deserializer.h), while both backends have to support
+// std::nullptr_t, bool, std::int64_t, std::uint64_t, double and std::string, which is what the values are read as
+// (blobs are read and written as a std::string). Only the keys and a single string are held at any time. The nesting is
+// followed by recursion, so it's limited to maximumDepth levels, deeper input is reported as errc::invalid_data.
+// Transcoding stops at the first error of the source.
+template <typename Source, typename Target>
+class Transcoder {
+public:
+    static constexpr std::size_t defaultDepth = 256;
+
+    Transcoder(Source& from, Target& to, std::size_t maximumDepth = defaultDepth) : source(from), target(to), limit(maximumDepth) {}
+
+    void run() {
+        entry(source, target);
+    }
+
+private:
+    // Copies the next value: the next element of an array, or the value of the given key in an object
+    template <typename From, typename To, typename ... Key>
+    void entry(From& from, To& to, const Key& ... key) {
+        if (failed()) return;
+        switch (from.valueKind()) {
+        case Kind::Null:
+            scalar<std::nullptr_t>(from, to, key...);
+            break;
+        case Kind::Bool:
+            scalar<bool>(from, to, key...);
+            break;
+        case Kind::Integer:
+            scalar<std::int64_t>(from, to, key...);
+            break;
+        case Kind::Unsigned:
+            scalar<std::uint64_t>(from, to, key...);
+            break;
+        case Kind::Floating:
+            scalar<double>(from, to, key...);
+            break;
+        case Kind::String:
+            from.value(key..., text);
+            if (!failed()) to.value(key..., text);
+            break;
+        case Kind::Blob: {
+            {
+                auto input = from.blob(key...);
+                input.value(text);
+            }
+            if (failed()) break;
+            auto output = to.blob(key...);
+            output.value(text);
+            break;
+        }
+        case Kind::Object: {
+            if (!descend()) break;
+            auto input = from.object(key...);
+            auto output = to.object(key...);
+            for (std::size_t i = 0, size = input.size(); i < size && !failed(); ++i) {
+                auto name = input.peekKey();
+                entry(input, output, name);
+            }
+            depth--;
+            break;
+        }
+        case Kind::Array: {
+            if (!descend()) break;
+            auto input = from.array(key...);
+            auto output = to.array(key...);
+            for (std::size_t i = 0, size = input.size(); i < size && !failed(); ++i) {
+                entry(input, output);
+            }
+            depth--;
+            break;
+        }
+        }
+    }
+
+    template <typename ValueType, typename From, typename To, typename ... Key>
+    void scalar(From& from, To& to, const Key& ... key) {
+        ValueType v {};
+        from.value(key..., v);
+        if (!failed()) to.value(key..., v);
+    }
+
+    bool descend() {
+        if (depth < limit) {
+            depth++;
+            return true;
+        }
+        detail::fail(source, errc::invalid_data, [this] () { return "Nesting deeper than " + std::to_string(limit) + " levels"; });
+        return false;
+    }
+
+    bool failed() const noexcept {
+        if constexpr (records_errors_v<Source>) {
+            return source.failed();
+        }
+        else {
+            return false;
+        }
+    }
+
+    Source& source;
+    Target& target;
+    std::string text;   // Reused for all the string values
+    std::size_t depth = 0, limit;
+};
+
+template <typename Source, typename Target>
+std::enable_if_t<is_deserializer_v<Source> && is_serializer_v<Target>> transcode(Source& from, Target& to, std::size_t maximumDepth = Transcoder<Source, Target>::defaultDepth) {
+    Transcoder<Source, Target>(from, to, maximumDepth).run();
+}
+}
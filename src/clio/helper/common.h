@@ -2,11 +2,61 @@
 // SPDX-License-Identifier: MIT
 
 #pragma once
+#include "../Clio.h"
+#include "../Error.h"
+#include "../Identities.h"
 #include <utility>
 #include <iterator>
+#include <algorithm>
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// How the entries of maps with keys that can't be object keys are written. Pass the layout as an argument, e.g.
+// object.value("index", index, Clio::MapLayout::pairs), or set the default for a backend with `using map_layout = Clio::MapLayout::Pairs;`
+namespace Clio::MapLayout {
+struct Objects {};  // [{"key": k, "value": v}, ...]
+struct Pairs {};    // [[k, v], ...]
+struct Columns {};  // [[k, ...], [v, ...]]
+
+inline constexpr Objects objects {};
+inline constexpr Pairs pairs {};
+inline constexpr Columns columns {};
+}
+
+// Deserializes into the existing contents instead of replacing them, e.g. d.value(state, Clio::in_place).
+// Sequences are resized and their elements overwritten, map entries with the same key keep their node and value,
+// so strings and nested containers are reused along with their capacity. The tag is passed on to the elements whose
+// deserialize() accepts it, while additional arguments are passed on to the elements as they are.
+namespace Clio {
+struct InPlace {};
+inline constexpr InPlace in_place {};
+}
 
 namespace Clio::detail {
+// Returns false if the sizes differ and the deserialization can't continue
+template <typename Interface>
+bool check_size(Interface& d, const char* what, std::size_t expected, std::size_t actual) {
+    if (expected == actual) return true;
+    fail(d, errc::size_mismatch, [&] () {
+        return std::string(what) + " size mismatch: expecting " + std::to_string(expected) + ", got " + std::to_string(actual);
+    });
+    return false;
+}
+
+#ifdef CLIO_HAS_CONCEPTS
+template <typename Container>
+void reserve(Container& c, std::size_t size) {
+    if constexpr (requires { c.reserve(size); }) {
+        c.clear();
+        c.reserve(size);
+    }
+}
+#else
 template <typename Container, typename = void>
 struct reserve {
     reserve(Container&, std::size_t) {}
@@ -18,6 +68,42 @@ struct reserve<Container, std::void_t<decltype(std::declval<Container>().reserve
         c.reserve(size);
     }
 };
+#endif
+
+template <typename Container, typename = void>
+struct has_resize : std::false_type {};
+template <typename Container>
+struct has_resize<Container, std::void_t<decltype(std::declval<Container&>().resize(std::size_t{}))>> : std::true_type {};
+
+template <typename Container, typename = void>
+struct has_extract : std::false_type {};
+template <typename Container>
+struct has_extract<Container, std::void_t<decltype(std::declval<Container&>().extract(std::declval<const typename Container::key_type&>()))>> : std::true_type {};
+
+template <typename Interface, typename Type, typename = void>
+struct accepts_in_place : std::false_type {};
+template <typename Interface, typename Type>
+struct accepts_in_place<Interface, Type, std::void_t<decltype(deserialize(std::declval<Interface&>(), std::declval<Type&>(), in_place))>> : std::true_type {};
+template <typename Interface, typename Type>
+inline constexpr bool accepts_in_place_v = accepts_in_place<Interface, Type>::value;
+
+template <typename Tag>
+inline constexpr bool is_in_place_v = std::is_same_v<remove_cvref_t<Tag>, InPlace>;
+template <typename ... Arguments>
+inline constexpr bool starts_in_place_v = false;
+template <typename Head, typename ... Tail>
+inline constexpr bool starts_in_place_v<Head, Tail...> = is_in_place_v<Head>;
+
+// Reads an item of an array (or, given the key, of an object) passing on the in-place tag if the item accepts it
+template <typename Interface, typename Scope, typename Item, typename ... Key>
+void value_in_place(Scope& scope, Item& item, Key&& ... key) {
+    if constexpr (accepts_in_place_v<Interface, Item>) {
+        scope.value(std::forward<Key>(key)..., item, in_place);
+    }
+    else {
+        scope.value(std::forward<Key>(key)..., item);
+    }
+}
 
 template <typename Functor, typename Interface, typename Key, typename Item, typename = void>
 struct is_extended_functor : std::false_type {};
@@ -49,7 +135,7 @@ void deserialize_sequence(Interface& d, Container& v) {
     auto array = d.array();
     reserve(v, array.size());
     auto inserter = std::inserter(v, v.end());
-    for (Size i = 0, size = array.size(); i < size; ++i) {
+    for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
         Item item;
         array.value(item);
         inserter = std::move(item);
@@ -82,6 +168,29 @@ void serialize_sequence(Interface& s, const Container& v, Head&& head, Tail&& ..
     }
 }
 
+// Containers that can't be resized, or whose elements can't be referenced (std::vector<bool>), are deserialized anew
+template <typename Interface, typename Container, typename ... Arguments>
+void deserialize_sequence(Interface& d, Container& v, InPlace, Arguments&& ... args) {
+    using Size = decltype(std::size(v));
+
+    if constexpr (has_resize<Container>::value && std::is_lvalue_reference_v<decltype(*std::begin(v))>) {
+        auto array = d.array();
+        v.resize(array.size());
+        auto item = std::begin(v);
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i, ++item) {
+            if constexpr (sizeof...(Arguments) == 0) {
+                value_in_place<Interface>(array, *item);
+            }
+            else {
+                array.value(*item, args...);
+            }
+        }
+    }
+    else {
+        deserialize_sequence(d, v, std::forward<Arguments>(args)...);
+    }
+}
+
 template <typename Interface, typename Container, typename Head, typename ... Tail>
 void deserialize_sequence(Interface& d, Container& v, Head&& head, Tail&& ... args) {
     using Size = decltype(std::size(v));
@@ -93,14 +202,14 @@ void deserialize_sequence(Interface& d, Container& v, Head&& head, Tail&& ... ar
 
     if constexpr (is_functor<Head, Interface, Item&, Tail...>) {
         auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::placeholders::_2, std::forward<Tail>(args)...);
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             Item item;
             array.value(item, f);
             inserter = std::move(item);
         }
     }
     else if constexpr (is_functor<Head, Interface, Size, Item&, Tail...>) {
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             Item item;
             auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, i, std::placeholders::_2, std::forward<Tail>(args)...);
             array.value(item, std::move(f));
@@ -108,7 +217,7 @@ void deserialize_sequence(Interface& d, Container& v, Head&& head, Tail&& ... ar
         }
     }
     else {
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             Item item;
             array.value(item, std::forward<Head>(head), std::forward<Tail>(args)...);
             inserter = std::move(item);
@@ -134,7 +243,7 @@ void deserialize_associative_direct(Interface& d, Container& v) {
 
     auto object = d.object();
     reserve(v, object.size());
-    for (Size i = 0, size = object.size(); i < size; ++i) {
+    for (Size i = 0, size = object.size(); i < size && !failed(d); ++i) {
         Key key = Key(object.peekKey());
         Item value;
         object.value(key, value);
@@ -177,7 +286,7 @@ void deserialize_associative_direct(Interface& d, Container& v, Head&& head, Tai
     reserve(v, object.size());
     if constexpr (is_functor<Head, Interface, Item&, Tail...>) {
         auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::placeholders::_2, std::forward<Tail>(args)...);
-        for (Size i = 0, size = object.size(); i < size; ++i) {
+        for (Size i = 0, size = object.size(); i < size && !failed(d); ++i) {
             Key key = Key(object.peekKey());
             Item item;
             object.value(key, item, f);
@@ -185,7 +294,7 @@ void deserialize_associative_direct(Interface& d, Container& v, Head&& head, Tai
         }
     }
     else if constexpr (is_functor<Head, Interface, std::add_const_t<Key>&, Item&, Tail...>) {
-        for (Size i = 0, size = object.size(); i < size; ++i) {
+        for (Size i = 0, size = object.size(); i < size && !failed(d); ++i) {
             Key key = Key(object.peekKey());
             Item item;
             auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::as_const(key), std::placeholders::_2, std::forward<Tail>(args)...);
@@ -194,7 +303,7 @@ void deserialize_associative_direct(Interface& d, Container& v, Head&& head, Tai
         }
     }
     else {
-        for (Size i = 0, size = object.size(); i < size; ++i) {
+        for (Size i = 0, size = object.size(); i < size && !failed(d); ++i) {
             Key key = Key(object.peekKey());
             Item item;
             object.value(key, item, std::forward<Head>(head), std::forward<Tail>(args)...);
@@ -203,8 +312,22 @@ void deserialize_associative_direct(Interface& d, Container& v, Head&& head, Tai
     }
 }
 
-constexpr auto key_label = "key";
-constexpr auto value_label = "value";
+constexpr char key_label[] = "key";
+constexpr char value_label[] = "value";
+
+template <typename Interface, typename = void>
+struct map_layout {
+    using type = MapLayout::Objects;
+};
+template <typename Interface>
+struct map_layout<Interface, std::void_t<typename Interface::map_layout>> {
+    using type = typename Interface::map_layout;
+};
+template <typename Interface>
+using map_layout_t = typename map_layout<Interface>::type;
+
+template <typename Type>
+inline constexpr bool is_map_layout_v = std::is_same_v<remove_cvref_t<Type>, MapLayout::Objects> || std::is_same_v<remove_cvref_t<Type>, MapLayout::Pairs> || std::is_same_v<remove_cvref_t<Type>, MapLayout::Columns>;
 
 template <typename Interface, typename Container>
 void serialize_associative_generic(Interface& s, const Container& v) {
@@ -224,7 +347,7 @@ void deserialize_associative_generic(Interface& d, Container& v) {
 
     auto array = d.array();
     reserve(v, array.size());
-    for (Size i = 0, size = array.size(); i < size; ++i) {
+    for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
         Key key;
         Item value;
         auto object = d.object();
@@ -234,6 +357,8 @@ void deserialize_associative_generic(Interface& d, Container& v) {
     }
 }
 
+// An extended functor, f(node, key, item), writes (and reads) the whole entry in the Objects layout, key included,
+// while the other layouts handle the key themselves and leave the item only to it
 template <typename Interface, typename Container, typename Head, typename ... Tail>
 void serialize_associative_generic(Interface& s, const Container& v, Head&& head, Tail&& ... args) {
     using Key = std::add_const_t<typename Container::key_type>;
@@ -273,7 +398,7 @@ void deserialize_associative_generic(Interface& d, Container& v, Head&& head, Ta
     reserve(v, array.size());
     if constexpr (is_functor<Head, Interface, Item&, Tail...>) {
         auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::placeholders::_2, std::forward<Tail>(args)...);
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             Key key;
             Item item;
             auto object = array.object();
@@ -283,7 +408,7 @@ void deserialize_associative_generic(Interface& d, Container& v, Head&& head, Ta
         }
     }
     else if constexpr (is_functor<Head, Interface, Key&, Item&, Tail...>) {
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             Key key;
             Item item;
             auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::ref(key), std::placeholders::_2, std::forward<Tail>(args)...);
@@ -292,7 +417,7 @@ void deserialize_associative_generic(Interface& d, Container& v, Head&& head, Ta
         }
     }
     else {
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             Key key;
             Item item;
             auto object = array.object();
@@ -303,28 +428,530 @@ void deserialize_associative_generic(Interface& d, Container& v, Head&& head, Ta
     }
 }
 
-template <typename Interface, typename Container, typename ... Arguments>
-void serialize_associative(Interface& s, const Container& v, Arguments&& ... args) {
+template <typename Interface, typename Container>
+void serialize_associative_pairs(Interface& s, const Container& v) {
+    auto array = s.array();
+    for (auto& [key, item] : v) {
+        auto entry = array.array();
+        entry.value(key);
+        entry.value(item);
+    }
+}
+
+template <typename Interface, typename Container>
+void deserialize_associative_pairs(Interface& d, Container& v) {
+    using Size = decltype(d.array().size());
+    using Key = typename Container::key_type;
+    using Item = typename Container::mapped_type;
+
+    auto array = d.array();
+    reserve(v, array.size());
+    for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+        Key key;
+        Item item;
+        auto entry = array.array();
+        if (!check_size(d, "Map entry", 2, entry.size())) return;
+        entry.value(key);
+        entry.value(item);
+        v.emplace(std::move(key), std::move(item));
+    }
+}
+
+template <typename Interface, typename Container, typename Head, typename ... Tail>
+void serialize_associative_pairs(Interface& s, const Container& v, Head&& head, Tail&& ... args) {
+    using Key = std::add_const_t<typename Container::key_type>;
+    using Item = typename Container::mapped_type;
+
+    auto array = s.array();
+    if constexpr (is_functor<Head, Interface, Item, Tail...>) {
+        auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::placeholders::_2, std::forward<Tail>(args)...);
+        for (auto& [key, item] : v) {
+            auto entry = array.array();
+            entry.value(key);
+            entry.value(item, f);
+        }
+    }
+    else if constexpr (is_functor<Head, Interface, Key, Item, Tail...>) {
+        for (auto& [key, item] : v) {
+            auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::as_const(key), std::placeholders::_2, std::forward<Tail>(args)...);
+            auto entry = array.array();
+            entry.value(key);
+            entry.value(item, std::move(f));
+        }
+    }
+    else {
+        for (auto& [key, item] : v) {
+            auto entry = array.array();
+            entry.value(key);
+            entry.value(item, std::forward<Head>(head), std::forward<Tail>(args)...);
+        }
+    }
+}
+
+template <typename Interface, typename Container, typename Head, typename ... Tail>
+void deserialize_associative_pairs(Interface& d, Container& v, Head&& head, Tail&& ... args) {
+    using Size = decltype(d.array().size());
+    using Key = typename Container::key_type;
+    using Item = typename Container::mapped_type;
+
+    auto array = d.array();
+    reserve(v, array.size());
+    if constexpr (is_functor<Head, Interface, Item&, Tail...>) {
+        auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::placeholders::_2, std::forward<Tail>(args)...);
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+            Key key;
+            Item item;
+            auto entry = array.array();
+            if (!check_size(d, "Map entry", 2, entry.size())) return;
+            entry.value(key);
+            entry.value(item, f);
+            v.emplace(std::move(key), std::move(item));
+        }
+    }
+    else if constexpr (is_functor<Head, Interface, std::add_const_t<Key>&, Item&, Tail...>) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+            Key key;
+            Item item;
+            auto entry = array.array();
+            if (!check_size(d, "Map entry", 2, entry.size())) return;
+            entry.value(key);
+            auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::as_const(key), std::placeholders::_2, std::forward<Tail>(args)...);
+            entry.value(item, std::move(f));
+            v.emplace(std::move(key), std::move(item));
+        }
+    }
+    else {
+        static_assert(!is_functor<Head, Interface, Key&, Item&, Tail...>, "The Pairs layout reads the keys itself, an extended functor gets the key as const Key& and reads the item only");
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+            Key key;
+            Item item;
+            auto entry = array.array();
+            if (!check_size(d, "Map entry", 2, entry.size())) return;
+            entry.value(key);
+            entry.value(item, std::forward<Head>(head), std::forward<Tail>(args)...);
+            v.emplace(std::move(key), std::move(item));
+        }
+    }
+}
+
+template <typename Interface, typename Container>
+void serialize_associative_columns(Interface& s, const Container& v) {
+    auto columns = s.array();
+    {
+        auto keys = columns.array();
+        for (auto& entry : v) {
+            keys.value(entry.first);
+        }
+    }
+    auto items = columns.array();
+    for (auto& entry : v) {
+        items.value(entry.second);
+    }
+}
+
+template <typename Interface, typename Container>
+void deserialize_associative_columns(Interface& d, Container& v) {
+    using Size = decltype(d.array().size());
+    using Key = typename Container::key_type;
+    using Item = typename Container::mapped_type;
+
+    auto columns = d.array();
+    if (!check_size(d, "Map columns", 2, columns.size())) return;
+    std::vector<Key> keys;
+    deserialize_sequence(d, keys);
+    auto items = columns.array();
+    if (!check_size(d, "Map columns", keys.size(), items.size())) return;
+    reserve(v, keys.size());
+    for (Size i = 0, size = items.size(); i < size && !failed(d); ++i) {
+        Item item;
+        items.value(item);
+        v.emplace(std::move(keys[i]), std::move(item));
+    }
+}
+
+template <typename Interface, typename Container, typename Head, typename ... Tail>
+void serialize_associative_columns(Interface& s, const Container& v, Head&& head, Tail&& ... args) {
+    using Key = std::add_const_t<typename Container::key_type>;
+    using Item = typename Container::mapped_type;
+
+    auto columns = s.array();
+    {
+        auto keys = columns.array();
+        for (auto& entry : v) {
+            keys.value(entry.first);
+        }
+    }
+    auto items = columns.array();
+    if constexpr (is_functor<Head, Interface, Key, Item, Tail...>) {
+        for (auto& [key, item] : v) {
+            auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::as_const(key), std::placeholders::_2, std::forward<Tail>(args)...);
+            items.value(item, std::move(f));
+        }
+    }
+    else {
+        for (auto& entry : v) {
+            items.value(entry.second, std::forward<Head>(head), std::forward<Tail>(args)...);
+        }
+    }
+}
+
+template <typename Interface, typename Container, typename Head, typename ... Tail>
+void deserialize_associative_columns(Interface& d, Container& v, Head&& head, Tail&& ... args) {
+    using Size = decltype(d.array().size());
+    using Key = typename Container::key_type;
+    using Item = typename Container::mapped_type;
+
+    auto columns = d.array();
+    if (!check_size(d, "Map columns", 2, columns.size())) return;
+    std::vector<Key> keys;
+    deserialize_sequence(d, keys);
+    auto items = columns.array();
+    if (!check_size(d, "Map columns", keys.size(), items.size())) return;
+    reserve(v, keys.size());
+    if constexpr (is_functor<Head, Interface, std::add_const_t<Key>&, Item&, Tail...>) {
+        for (Size i = 0, size = items.size(); i < size && !failed(d); ++i) {
+            Item item;
+            auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::as_const(keys[i]), std::placeholders::_2, std::forward<Tail>(args)...);
+            items.value(item, std::move(f));
+            v.emplace(std::move(keys[i]), std::move(item));
+        }
+    }
+    else {
+        static_assert(!is_functor<Head, Interface, Key&, Item&, Tail...>, "The Columns layout reads the keys itself, an extended functor gets the key as const Key& and reads the item only");
+        for (Size i = 0, size = items.size(); i < size && !failed(d); ++i) {
+            Item item;
+            items.value(item, std::forward<Head>(head), std::forward<Tail>(args)...);
+            v.emplace(std::move(keys[i]), std::move(item));
+        }
+    }
+}
+
+template <typename Layout, typename Interface, typename Container, typename ... Arguments>
+void serialize_associative_as(Interface& s, const Container& v, Arguments&& ... args) {
     using Key = typename Container::key_type;
     if constexpr (std::is_convertible_v<Key, std::string_view>) {
         serialize_associative_direct(s, v, std::forward<Arguments>(args)...);
     }
+    else if constexpr (std::is_same_v<Layout, MapLayout::Pairs>) {
+        serialize_associative_pairs(s, v, std::forward<Arguments>(args)...);
+    }
+    else if constexpr (std::is_same_v<Layout, MapLayout::Columns>) {
+        serialize_associative_columns(s, v, std::forward<Arguments>(args)...);
+    }
     else {
         serialize_associative_generic(s, v, std::forward<Arguments>(args)...);
     }
 }
 
-template <typename Interface, typename Container, typename ... Arguments>
-void deserialize_associative(Interface& s, Container& v, Arguments&& ... args) {
+// Scratch storage of the in-place map decoding, kept per thread for the next decode of the same type of map
+template <typename Container>
+struct MapScratch {
+    std::vector<const typename Container::value_type*> seen;    // The entries read, by address
+    std::vector<typename Container::key_type> keys;             // The key column
+    typename Container::key_type key {};
+};
+
+template <typename Container>
+MapScratch<Container>& map_scratch() {
+    thread_local MapScratch<Container> scratch;
+    return scratch;
+}
+
+// Reads into the value of an existing entry with the same key, or inserts a new one, and records the entry as seen
+template <typename Container, typename Read>
+void read_entry(Container& v, std::vector<const typename Container::value_type*>& seen, const typename Container::key_type& key, Read&& read) {
+    using Item = typename Container::mapped_type;
+
+    auto found = v.find(key);
+    if (found == v.end()) {
+        Item item;
+        read(item);
+        found = v.emplace(key, std::move(item)).first;
+    }
+    else {
+        read(found->second);
+    }
+    seen.push_back(&*found);
+}
+
+// Drops the entries that weren't seen
+template <typename Container>
+void drop_unseen(Container& v, std::vector<const typename Container::value_type*>& seen) {
+    std::less<const typename Container::value_type*> less;
+    std::sort(seen.begin(), seen.end(), less);
+    for (auto entry = v.begin(); entry != v.end();) {
+        if (std::binary_search(seen.begin(), seen.end(), &*entry, less)) ++entry;
+        else entry = v.erase(entry);
+    }
+}
+
+template <typename Layout, typename Interface, typename Container, typename ... Arguments>
+void deserialize_associative_as(Interface& d, Container& v, Arguments&& ... args);
+
+// The incoming entries are read into the existing ones with the same key, and those that don't come again are dropped,
+// so the container itself (its nodes, bucket array, comparator and allocator) is kept. The scratch buffers are taken for
+// the duration of the call, so a nested map of the same type gets its own. Maps without node extraction, whose entries
+// may move as others are inserted, are deserialized anew
+template <typename Layout, typename Interface, typename Container, typename ... Arguments>
+void deserialize_associative_in_place(Interface& d, Container& v, InPlace, Arguments&& ... args) {
     using Key = typename Container::key_type;
-    if constexpr (std::is_convertible_v<Key, std::string_view>) {
-        deserialize_associative_direct(s, v, std::forward<Arguments>(args)...);
+    using Item = typename Container::mapped_type;
+
+    if constexpr (!has_extract<Container>::value) {
+        deserialize_associative_as<Layout>(d, v, std::forward<Arguments>(args)...);
+    }
+    else {
+        auto read = [&args...] (auto& scope, Item& item, auto&& ... key) {
+            if constexpr (sizeof...(Arguments) == 0) {
+                value_in_place<Interface>(scope, item, key...);
+            }
+            else {
+                scope.value(key..., item, args...);
+            }
+        };
+
+        MapScratch<Container> scratch = std::move(map_scratch<Container>());
+        auto& seen = scratch.seen;
+        auto& keys = scratch.keys;
+        auto& key = scratch.key;
+        seen.clear();
+        [&] () {
+            if constexpr (std::is_convertible_v<Key, std::string_view>) {
+                using Size = decltype(d.object().size());
+                auto object = d.object();
+                for (Size i = 0, size = object.size(); i < size && !failed(d); ++i) {
+                    key = object.peekKey();
+                    read_entry(v, seen, key, [&] (Item& item) { read(object, item, std::as_const(key)); });
+                }
+            }
+            else if constexpr (std::is_same_v<Layout, MapLayout::Pairs>) {
+                using Size = decltype(d.array().size());
+                auto array = d.array();
+                for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+                    auto entry = array.array();
+                    if (!check_size(d, "Map entry", 2, entry.size())) return;
+                    value_in_place<Interface>(entry, key);
+                    read_entry(v, seen, key, [&] (Item& item) { read(entry, item); });
+                }
+            }
+            else if constexpr (std::is_same_v<Layout, MapLayout::Columns>) {
+                using Size = decltype(d.array().size());
+                auto columns = d.array();
+                if (!check_size(d, "Map columns", 2, columns.size())) return;
+                deserialize_sequence(d, keys, in_place);
+                auto items = columns.array();
+                if (!check_size(d, "Map columns", keys.size(), items.size())) return;
+                for (Size i = 0, size = items.size(); i < size && !failed(d); ++i) {
+                    read_entry(v, seen, keys[i], [&] (Item& item) { read(items, item); });
+                }
+            }
+            else {
+                using Size = decltype(d.array().size());
+                auto array = d.array();
+                for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+                    auto object = array.object();
+                    value_in_place<Interface>(object, key, key_label);
+                    read_entry(v, seen, key, [&] (Item& item) { read(object, item, value_label); });
+                }
+            }
+        }();
+        drop_unseen(v, seen);
+        map_scratch<Container>() = std::move(scratch);
+    }
+}
+
+template <typename Layout, typename Interface, typename Container, typename ... Arguments>
+void deserialize_associative_as(Interface& d, Container& v, Arguments&& ... args) {
+    using Key = typename Container::key_type;
+    if constexpr (starts_in_place_v<Arguments...>) {
+        deserialize_associative_in_place<Layout>(d, v, std::forward<Arguments>(args)...);
+    }
+    else if constexpr (std::is_convertible_v<Key, std::string_view>) {
+        deserialize_associative_direct(d, v, std::forward<Arguments>(args)...);
+    }
+    else if constexpr (std::is_same_v<Layout, MapLayout::Pairs>) {
+        deserialize_associative_pairs(d, v, std::forward<Arguments>(args)...);
+    }
+    else if constexpr (std::is_same_v<Layout, MapLayout::Columns>) {
+        deserialize_associative_columns(d, v, std::forward<Arguments>(args)...);
     }
     else {
-        deserialize_associative_generic(s, v, std::forward<Arguments>(args)...);
+        deserialize_associative_generic(d, v, std::forward<Arguments>(args)...);
     }
 }
 
+template <typename Interface, typename Container>
+void serialize_associative(Interface& s, const Container& v) {
+    serialize_associative_as<map_layout_t<Interface>>(s, v);
+}
+
+template <typename Interface, typename Container>
+void deserialize_associative(Interface& d, Container& v) {
+    deserialize_associative_as<map_layout_t<Interface>>(d, v);
+}
+
+// The layout may be given as the first argument, otherwise the backend's default is used
+template <typename Interface, typename Container, typename Head, typename ... Tail>
+void serialize_associative(Interface& s, const Container& v, Head&& head, Tail&& ... args) {
+    if constexpr (is_map_layout_v<Head>) {
+        serialize_associative_as<remove_cvref_t<Head>>(s, v, std::forward<Tail>(args)...);
+    }
+    else {
+        serialize_associative_as<map_layout_t<Interface>>(s, v, std::forward<Head>(head), std::forward<Tail>(args)...);
+    }
+}
+
+template <typename Interface, typename Container, typename Head, typename ... Tail>
+void deserialize_associative(Interface& d, Container& v, Head&& head, Tail&& ... args) {
+    if constexpr (is_map_layout_v<Head>) {
+        deserialize_associative_as<remove_cvref_t<Head>>(d, v, std::forward<Tail>(args)...);
+    }
+    else {
+        deserialize_associative_as<map_layout_t<Interface>>(d, v, std::forward<Head>(head), std::forward<Tail>(args)...);
+    }
+}
+
+// -- Tuple helpers (a.k.a. std::pair, std::tuple), written as fixed-size heterogeneous arrays
+
+template <typename Interface, typename Tuple>
+void serialize_tuple(Interface& s, const Tuple& v) {
+    auto array = s.array();
+    std::apply([&array] (const auto& ... items) { (array.value(items), ...); }, v);
+}
+
+template <typename Interface, typename Tuple>
+void deserialize_tuple(Interface& d, Tuple& v) {
+    constexpr std::size_t size = std::tuple_size_v<Tuple>;
+    auto array = d.array();
+    if (!check_size(d, "Tuple", size, array.size())) return;
+    std::apply([&array] (auto& ... items) { (array.value(items), ...); }, v);
+}
+
+// -- Pointer helpers (a.k.a. std::shared_ptr, std::unique_ptr), written as {} for null and {"value": ...} otherwise.
+// With an identity table shared objects are written once as {"id": n, "value": ...} and then as {"ref": n}.
+
+constexpr char id_label[] = "id";
+constexpr char reference_label[] = "ref";
+
+template <typename Interface, typename = void>
+struct has_identities : std::false_type {};
+template <typename Interface>
+struct has_identities<Interface, std::void_t<decltype(std::declval<Interface&>().identities())>> : std::true_type {};
+template <typename Interface>
+inline constexpr bool has_identities_v = has_identities<Interface>::value;
+
+template <typename Interface, typename Type, typename ... Arguments>
+void serialize_pointer(Interface& s, const Type* v, Arguments&& ... args) {
+    auto object = s.object();
+    if (v) object.value(value_label, *v, std::forward<Arguments>(args)...);
+}
+
+template <typename Interface, typename Pointer, typename ... Arguments>
+void deserialize_pointer(Interface& d, Pointer& v, Arguments&& ... args) {
+    using Item = std::remove_const_t<typename Pointer::element_type>;
+
+    auto object = d.object();
+    if (!object.hasKey(value_label)) {
+        v.reset();
+        return;
+    }
+    auto item = std::make_unique<Item>();
+    object.value(value_label, *item, std::forward<Arguments>(args)...);
+    v = std::move(item);
+}
+
+// In place an existing pointee is read into, and the tag is passed on only if the pointee accepts it
+template <typename Interface, typename Pointer, typename ... Arguments>
+void deserialize_pointer(Interface& d, Pointer& v, InPlace, Arguments&& ... args) {
+    using Item = std::remove_const_t<typename Pointer::element_type>;
+
+    if constexpr (std::is_const_v<typename Pointer::element_type>) {
+        deserialize_pointer(d, v, std::forward<Arguments>(args)...);
+    }
+    else {
+        auto object = d.object();
+        if (!object.hasKey(value_label)) {
+            v.reset();
+            return;
+        }
+        if (!v) v = std::make_unique<Item>();
+        if constexpr (sizeof...(Arguments) == 0) {
+            value_in_place<Interface>(object, *v, value_label);
+        }
+        else {
+            object.value(value_label, *v, std::forward<Arguments>(args)...);
+        }
+    }
+}
+
+template <typename Interface, typename Type, typename ... Arguments>
+void serialize_shared(Interface& s, const std::shared_ptr<Type>& v, Arguments&& ... args) {
+    if constexpr (has_identities_v<Interface>) {
+        auto object = s.object();
+        if (!v) return;
+
+        auto [id, added] = s.identities().insert(v);
+        if (!added) {
+            object.value(reference_label, id);
+            return;
+        }
+        object.value(id_label, id);
+        object.value(value_label, *v, std::forward<Arguments>(args)...);
+    }
+    else {
+        serialize_pointer(s, v.get(), std::forward<Arguments>(args)...);
+    }
+}
+
+// The object is registered before its value is read, so references to it from within (cycles) resolve as well
+template <typename Interface, typename Type, typename ... Arguments>
+void deserialize_shared(Interface& d, std::shared_ptr<Type>& v, Arguments&& ... args) {
+    using Item = std::remove_const_t<Type>;
+    using Id = Identities::Id;
+
+    if constexpr (has_identities_v<Interface>) {
+        auto object = d.object();
+        if (object.hasKey(reference_label)) {
+            Id id = 0;
+            object.value(reference_label, id);
+            if (failed(d)) return;
+            std::shared_ptr<Item> found = d.identities().template find<Item>(id);
+            if (!found) {
+                fail(d, errc::invalid_data, [id] () { return "Unknown reference: " + std::to_string(id); });
+                return;
+            }
+            v = std::move(found);
+            return;
+        }
+        if (!object.hasKey(value_label)) {
+            v.reset();
+            return;
+        }
+
+        auto item = std::make_shared<Item>();
+        if (object.hasKey(id_label)) {
+            Id id = 0;
+            object.value(id_label, id);
+            if (failed(d)) return;
+            if (!d.identities().define(id, item)) {
+                fail(d, errc::invalid_data, [id] () { return "Unexpected object id: " + std::to_string(id); });
+                return;
+            }
+        }
+        object.value(value_label, *item, std::forward<Arguments>(args)...);
+        v = std::move(item);
+    }
+    else {
+        deserialize_pointer(d, v, std::forward<Arguments>(args)...);
+    }
+}
+
+// Shared objects may be referenced from elsewhere and aren't overwritten, they're always created anew and the tag is dropped
+template <typename Interface, typename Type, typename ... Arguments>
+void deserialize_shared(Interface& d, std::shared_ptr<Type>& v, InPlace, Arguments&& ... args) {
+    deserialize_shared(d, v, std::forward<Arguments>(args)...);
+}
+
 // -- Fixed-size sequence helpers (a.k.a. std::array, Type[], etc.)
 
 template <typename Interface, typename Container, typename ... Arguments>
@@ -334,33 +961,49 @@ template <typename Interface, typename Container>
 void deserialize_fixed_sequence(Interface& d, Container& v) {
     using Size = decltype(std::size(v));
     auto array = d.array();
-    if (array.size() != std::size(v)) throw std::runtime_error("Fixed-size array size mismatch: expecting " + std::to_string(std::size(v)) + ", got " + std::to_string(array.size()));
-    for (Size i = 0, size = array.size(); i < size; ++i) {
+    if (!check_size(d, "Fixed-size array", std::size(v), array.size())) return;
+    for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
         array.value(v[i]);
     }
 }
 
+// The elements are always overwritten, the tag is only passed on to them
+template <typename Interface, typename Container, typename ... Arguments>
+void deserialize_fixed_sequence(Interface& d, Container& v, InPlace, Arguments&& ... args) {
+    using Size = decltype(std::size(v));
+    auto array = d.array();
+    if (!check_size(d, "Fixed-size array", std::size(v), array.size())) return;
+    for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
+        if constexpr (sizeof...(Arguments) == 0) {
+            value_in_place<Interface>(array, v[i]);
+        }
+        else {
+            array.value(v[i], args...);
+        }
+    }
+}
+
 template <typename Interface, typename Container, typename Head, typename ... Tail>
 void deserialize_fixed_sequence(Interface& d, Container& v, Head&& head, Tail&& ... args) {
     using Size = decltype(std::size(v));
     using Item = std::remove_reference_t<decltype(*std::begin(v))>;
 
     auto array = d.array();
-    if (array.size() != std::size(v)) throw std::runtime_error("Fixed-size array size mismatch: expecting " + std::to_string(std::size(v)) + ", got " + std::to_string(array.size()));
+    if (!check_size(d, "Fixed-size array", std::size(v), array.size())) return;
     if constexpr (is_functor<Head, Interface, Item&, Tail...>) {
         auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, std::placeholders::_2, std::forward<Tail>(args)...);
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             array.value(v[i], f);
         }
     }
     else if constexpr (is_functor<Head, Interface, Size, Item&, Tail...>) {
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             auto f = std::bind(std::forward<Head>(head), std::placeholders::_1, i, std::placeholders::_2, std::forward<Tail>(args)...);
             array.value(v[i], std::move(f));
         }
     }
     else {
-        for (Size i = 0, size = array.size(); i < size; ++i) {
+        for (Size i = 0, size = array.size(); i < size && !failed(d); ++i) {
             array.value(v[i], std::forward<Head>(head), std::forward<Tail>(args)...);
         }
     }
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "../Clio.h"
+#include "common.h"
+#include <memory>
+
+namespace Clio {
+template <typename Interface, typename Type, typename ... Arguments>
+std::enable_if_t<is_serializer_v<Interface>> serialize(Interface& s, const std::shared_ptr<Type>& v, Arguments&& ... args) {
+    detail::serialize_shared(s, v, std::forward<Arguments>(args)...);
+}
+
+template <typename Interface, typename Type, typename ... Arguments>
+std::enable_if_t<is_deserializer_v<Interface>> deserialize(Interface& d, std::shared_ptr<Type>& v, Arguments&& ... args) {
+    detail::deserialize_shared(d, v, std::forward<Arguments>(args)...);
+}
+
+template <typename Interface, typename Type, typename ... Arguments>
+std::enable_if_t<is_serializer_v<Interface>> serialize(Interface& s, const std::unique_ptr<Type>& v, Arguments&& ... args) {
+    detail::serialize_pointer(s, v.get(), std::forward<Arguments>(args)...);
+}
+
+template <typename Interface, typename Type, typename ... Arguments>
+std::enable_if_t<is_deserializer_v<Interface>> deserialize(Interface& d, std::unique_ptr<Type>& v, Arguments&& ... args) {
+    detail::deserialize_pointer(d, v, std::forward<Arguments>(args)...);
+}
+}
@@ -0,0 +1,348 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "../Clio.h"
+#include "common.h"
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Packed encodings for sequences of integers, passed as the functor argument, for example:
+//      object.value("ids", ids, Clio::Packed::delta);
+// The sequence is encoded into a single blob (the backend needs beginBlob()/endBlob() and std::string support).
+// Decoding is driven by the blob's header, so either codec reads whatever was written.
+namespace Clio::detail {
+enum class PackedCodec : std::uint8_t { Varint = 0, Delta = 1 };
+
+template <typename Type>
+constexpr std::make_unsigned_t<Type> zigzag_encode(Type v) noexcept {
+    using Unsigned = std::make_unsigned_t<Type>;
+    if constexpr (std::is_signed_v<Type>) {
+        return static_cast<Unsigned>(static_cast<Unsigned>(v) << 1) ^ static_cast<Unsigned>(v >> (sizeof(Type) * 8 - 1));
+    }
+    else {
+        return v;
+    }
+}
+
+template <typename Type>
+constexpr Type zigzag_decode(std::make_unsigned_t<Type> v) noexcept {
+    using Unsigned = std::make_unsigned_t<Type>;
+    if constexpr (std::is_signed_v<Type>) {
+        return static_cast<Type>(static_cast<Unsigned>(v >> 1) ^ static_cast<Unsigned>(-static_cast<Unsigned>(v & 1)));
+    }
+    else {
+        return v;
+    }
+}
+
+inline void put_varint(std::string& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// Reads past the end (or a malformed varint) yield zeroes and set the error, so it can be checked once afterwards
+struct PackedReader {
+    const unsigned char* position;
+    const unsigned char* end;
+    errc error = errc();
+
+    std::uint8_t byte() noexcept {
+        if (position == end) {
+            error = errc::unexpected_end;
+            return 0;
+        }
+        return *position++;
+    }
+
+    std::uint64_t varint() noexcept {
+        std::uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (position == end) break;
+            std::uint8_t b = *position++;
+            v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        error = position == end ? errc::unexpected_end : errc::invalid_data;
+        return 0;
+    }
+};
+
+inline unsigned bit_width(std::uint64_t v) noexcept {
+    unsigned width = 0;
+    for (; v; v >>= 1) ++width;
+    return width;
+}
+
+// Appends count values of width bits each, least significant bit first
+template <typename Iterator>
+void pack_bits(std::string& out, Iterator values, std::size_t count, unsigned width) {
+    if (!width) return;
+    std::uint64_t accumulator = 0;
+    unsigned bits = 0;
+    for (std::size_t i = 0; i < count; ++i, ++values) {
+        std::uint64_t v = *values;
+        accumulator |= v << bits;
+        unsigned total = bits + width;
+        if (total >= 64) {
+            for (int j = 0; j < 8; ++j) out.push_back(static_cast<char>(accumulator >> (8 * j)));
+            accumulator = bits ? v >> (64 - bits) : 0;
+            total -= 64;
+        }
+        bits = total;
+    }
+    for (; bits > 0; bits = bits > 8 ? bits - 8 : 0, accumulator >>= 8) {
+        out.push_back(static_cast<char>(accumulator));
+    }
+}
+
+// Reads 8 bytes little endian, zero filling past the end of the data
+inline std::uint64_t load_bits(const unsigned char* data, std::size_t size, std::size_t offset) noexcept {
+    unsigned char buffer[8] = {};
+    std::size_t available = offset < size ? size - offset : 0;
+    std::memcpy(buffer, data + offset, available < 8 ? available : 8);
+    std::uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | buffer[i];
+    return v;
+}
+
+template <typename Unsigned>
+void unpack_bits(const unsigned char* data, std::size_t size, Unsigned* out, std::size_t count, unsigned width) noexcept {
+    if (!width) {
+        std::fill(out, out + count, Unsigned(0));
+        return;
+    }
+    const std::uint64_t mask = width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+    // Unaligned 64-bit loads cover any value up to 57 bits wide regardless of its bit offset
+    for (std::size_t i = 0, bit = 0; i < count; ++i, bit += width) {
+        std::size_t offset = bit >> 3;
+        unsigned shift = bit & 7;
+        std::uint64_t v;
+        if (offset + 8 <= size) {
+            std::memcpy(&v, data + offset, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            v = __builtin_bswap64(v);
+#endif
+        }
+        else {
+            v = load_bits(data, size, offset);
+        }
+        v >>= shift;
+        if (shift + width > 64) v |= load_bits(data, size, offset + 8) << (64 - shift);
+        out[i] = static_cast<Unsigned>(v & mask);
+    }
+}
+
+// In-place inclusive prefix sum over out[i] + reference, seeded with base (wrapping arithmetic)
+template <typename Unsigned>
+void prefix_sum(Unsigned* out, std::size_t count, Unsigned reference, Unsigned base) noexcept {
+    std::size_t i = 0;
+    if constexpr (sizeof(Unsigned) == 4) {
+#if defined(__AVX2__)
+        const __m256i frame = _mm256_set1_epi32(static_cast<int>(reference));
+        const __m256i last = _mm256_set1_epi32(7);
+        __m256i carry = _mm256_set1_epi32(static_cast<int>(base));
+        for (; i + 8 <= count; i += 8) {
+            __m256i* p = reinterpret_cast<__m256i*>(out + i);
+            __m256i x = _mm256_add_epi32(_mm256_loadu_si256(p), frame);
+            x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+            x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+            // Carry the low lane's total into the high lane
+            __m256i low = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+            x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low, low, 0x08));
+            x = _mm256_add_epi32(x, carry);
+            _mm256_storeu_si256(p, x);
+            carry = _mm256_permutevar8x32_epi32(x, last);
+        }
+        base = static_cast<Unsigned>(_mm256_cvtsi256_si32(carry));
+#elif defined(__SSE2__)
+        const __m128i frame = _mm_set1_epi32(static_cast<int>(reference));
+        __m128i carry = _mm_set1_epi32(static_cast<int>(base));
+        for (; i + 4 <= count; i += 4) {
+            __m128i* p = reinterpret_cast<__m128i*>(out + i);
+            __m128i x = _mm_add_epi32(_mm_loadu_si128(p), frame);
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, carry);
+            _mm_storeu_si128(p, x);
+            carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        base = static_cast<Unsigned>(_mm_cvtsi128_si32(carry));
+#endif
+    }
+    for (; i < count; ++i) {
+        base = static_cast<Unsigned>(base + static_cast<Unsigned>(out[i] + reference));
+        out[i] = base;
+    }
+}
+
+template <typename Container>
+void encode_packed(std::string& out, const Container& v, PackedCodec codec) {
+    using Type = remove_cvref_t<decltype(*std::begin(v))>;
+    using Unsigned = std::make_unsigned_t<Type>;
+    static_assert(std::is_integral_v<Type> && !std::is_same_v<Type, bool>, "Packed encoding requires a sequence of integers");
+
+    std::size_t count = static_cast<std::size_t>(std::distance(std::begin(v), std::end(v)));
+    out.push_back(static_cast<char>(codec));
+    put_varint(out, count);
+    if (!count) return;
+
+    if (codec == PackedCodec::Varint) {
+        for (auto item : v) put_varint(out, zigzag_encode(item));
+        return;
+    }
+
+    // Delta + frame of reference: the differences between consecutive values (wrapping), less the smallest of them,
+    // are bit-packed with the width of the largest.
+    auto it = std::begin(v);
+    Unsigned previous = static_cast<Unsigned>(*it);
+    put_varint(out, zigzag_encode(*it));
+    if (count == 1) return;
+
+    using Signed = std::make_signed_t<Type>;
+    Signed smallest = static_cast<Signed>(static_cast<Unsigned>(static_cast<Unsigned>(*std::next(it)) - previous));
+    Unsigned largest = 0;
+    for (auto current = std::next(it), end = std::end(v); current != end; ++current) {
+        Unsigned value = static_cast<Unsigned>(*current);
+        Signed delta = static_cast<Signed>(static_cast<Unsigned>(value - previous));
+        if (delta < smallest) smallest = delta;
+        previous = value;
+    }
+    previous = static_cast<Unsigned>(*it);
+    for (auto current = std::next(it), end = std::end(v); current != end; ++current) {
+        Unsigned value = static_cast<Unsigned>(*current);
+        Unsigned offset = static_cast<Unsigned>(value - previous - static_cast<Unsigned>(smallest));
+        if (offset > largest) largest = offset;
+        previous = value;
+    }
+
+    unsigned width = bit_width(largest);
+    put_varint(out, zigzag_encode(smallest));
+    out.push_back(static_cast<char>(width));
+
+    struct Offsets {
+        using Iterator = remove_cvref_t<decltype(std::begin(v))>;
+        std::uint64_t operator * () const { return static_cast<Unsigned>(static_cast<Unsigned>(*std::next(current)) - static_cast<Unsigned>(*current) - reference); }
+        Offsets& operator ++ () { ++current; return *this; }
+        Iterator current;
+        Unsigned reference;
+    };
+    pack_bits(out, Offsets { it, static_cast<Unsigned>(smallest) }, count - 1, width);
+}
+
+template <typename Container, typename = void>
+struct is_contiguous : std::false_type {};
+template <typename Container>
+struct is_contiguous<Container, std::void_t<decltype(std::data(std::declval<Container&>()))>> : std::true_type {};
+
+// Decoding allocates up front, and bit-packed sequences of equal deltas take no space at all, so the element count is
+// capped. A backend can raise (or lower) the cap with `static constexpr std::size_t packed_limit = ...;`
+inline constexpr std::size_t default_packed_limit = std::size_t(1) << 24;
+
+template <typename Interface, typename = void>
+struct packed_limit : std::integral_constant<std::size_t, default_packed_limit> {};
+template <typename Interface>
+struct packed_limit<Interface, std::void_t<decltype(Interface::packed_limit)>> : std::integral_constant<std::size_t, Interface::packed_limit> {};
+
+// The header is validated against the limit and the input size before anything is allocated
+template <typename Container>
+std::error_code decode_packed(const std::string& in, Container& v, std::size_t limit) {
+    using Type = remove_cvref_t<decltype(*std::begin(v))>;
+    using Unsigned = std::make_unsigned_t<Type>;
+    static_assert(std::is_integral_v<Type> && !std::is_same_v<Type, bool>, "Packed encoding requires a sequence of integers");
+
+    PackedReader reader { reinterpret_cast<const unsigned char*>(in.data()), reinterpret_cast<const unsigned char*>(in.data()) + in.size() };
+    auto codec = static_cast<PackedCodec>(reader.byte());
+    std::uint64_t count = reader.varint();
+    if (reader.error != errc()) return reader.error;
+    if (codec != PackedCodec::Varint && codec != PackedCodec::Delta) return errc::invalid_data;
+    if (count > limit) return errc::invalid_data;
+
+    Unsigned first = 0, reference = 0;
+    unsigned width = 0;
+    if (codec == PackedCodec::Varint) {
+        // Every element takes at least a byte
+        if (count > static_cast<std::uint64_t>(reader.end - reader.position)) return errc::unexpected_end;
+    }
+    else if (count > 0) {
+        first = static_cast<Unsigned>(zigzag_decode<Type>(static_cast<Unsigned>(reader.varint())));
+        if (count > 1) {
+            reference = static_cast<Unsigned>(zigzag_decode<std::make_signed_t<Type>>(static_cast<Unsigned>(reader.varint())));
+            width = reader.byte();
+            if (reader.error != errc()) return reader.error;
+            if (width > sizeof(Type) * 8) return errc::invalid_data;
+            std::size_t size = static_cast<std::size_t>(reader.end - reader.position);
+            if (width && count - 1 > size * 8 / width) return errc::unexpected_end;
+        }
+        if (reader.error != errc()) return reader.error;
+    }
+
+    if constexpr (has_resize<Container>::value) {
+        v.resize(static_cast<std::size_t>(count));
+    }
+    else if (count != std::size(v)) {
+        return errc::size_mismatch;
+    }
+    if (!count) return {};
+
+    Unsigned* out = reinterpret_cast<Unsigned*>(std::data(v));
+    if (codec == PackedCodec::Varint) {
+        for (std::size_t i = 0; i < count; ++i) out[i] = static_cast<Unsigned>(zigzag_decode<Type>(static_cast<Unsigned>(reader.varint())));
+        return reader.error;
+    }
+
+    out[0] = first;
+    if (count == 1) return {};
+    std::size_t size = static_cast<std::size_t>(reader.end - reader.position);
+    unpack_bits(reader.position, size, out + 1, static_cast<std::size_t>(count - 1), width);
+    prefix_sum(out + 1, static_cast<std::size_t>(count - 1), reference, out[0]);
+    return {};
+}
+}
+
+namespace Clio::Packed {
+template <detail::PackedCodec Codec>
+struct Encoding {
+    // Buffers up to this size are kept for the next sequence
+    static constexpr std::size_t retainedCapacity = 64 * 1024;
+
+    template <typename Interface, typename Container>
+    void operator () (Interface& node, Container& v) const {
+        static_assert(detail::is_contiguous<Container>::value, "Packed encoding requires a contiguous container (e.g. std::vector or std::array)");
+
+        thread_local std::string bytes;
+        bytes.clear();
+        if constexpr (is_serializer_v<Interface>) {
+            detail::encode_packed(bytes, v, Codec);
+            auto blob = node.blob();
+            blob.value(bytes);
+        }
+        else {
+            {
+                auto blob = node.blob();
+                blob.value(bytes);
+            }
+            if (!detail::failed(node)) {
+                if (auto error = detail::decode_packed(bytes, v, detail::packed_limit<Interface>::value)) {
+                    detail::fail(node, static_cast<errc>(error.value()), [&error] () { return "Packed integer sequence: " + error.message(); });
+                }
+            }
+        }
+        if (bytes.capacity() > retainedCapacity) std::string().swap(bytes);
+    }
+};
+
+// Zigzag (for signed types) LEB128 varints, for sequences of small or unordered values
+inline constexpr Encoding<detail::PackedCodec::Varint> varint {};
+// Delta + frame of reference bit-packing, for sorted or slowly changing sequences (ids, timestamps, counters)
+inline constexpr Encoding<detail::PackedCodec::Delta> delta {};
+}
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "../Clio.h"
+#include "common.h"
+#include <utility>
+
+namespace Clio {
+template <typename Interface, typename First, typename Second>
+std::enable_if_t<is_serializer_v<Interface>> serialize(Interface& s, const std::pair<First, Second>& v) {
+    detail::serialize_tuple(s, v);
+}
+
+template <typename Interface, typename First, typename Second>
+std::enable_if_t<is_deserializer_v<Interface>> deserialize(Interface& d, std::pair<First, Second>& v) {
+    detail::deserialize_tuple(d, v);
+}
+}
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "../Clio.h"
+#include "common.h"
+#include <tuple>
+
+namespace Clio {
+template <typename Interface, typename ... Types>
+std::enable_if_t<is_serializer_v<Interface>> serialize(Interface& s, const std::tuple<Types...>& v) {
+    detail::serialize_tuple(s, v);
+}
+
+template <typename Interface, typename ... Types>
+std::enable_if_t<is_deserializer_v<Interface>> deserialize(Interface& d, std::tuple<Types...>& v) {
+    detail::deserialize_tuple(d, v);
+}
+}
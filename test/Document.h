@@ -0,0 +1,338 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <clio/Serializer.h>
+#include <clio/Deserializer.h>
+#include <clio/Identities.h>
+#include <clio/helper/common.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+// In-memory document backend for the tests: the serializer builds a tree of values, which the deserializer walks.
+// The backend's policies are selected through the Options parameter.
+namespace Test {
+struct Value;
+using Members = std::vector<std::pair<std::string, std::shared_ptr<Value>>>;
+using Elements = std::vector<std::shared_ptr<Value>>;
+struct Bytes {
+    std::string data;
+};
+
+struct Value {
+    std::variant<std::nullptr_t, bool, std::int64_t, std::uint64_t, double, std::string, Members, Elements, Bytes> data;
+};
+
+template <typename Type>
+std::shared_ptr<Value> make(Type v) {
+    return std::make_shared<Value>(Value { std::move(v) });
+}
+
+inline std::string json(const Value& v) {
+    struct Visitor {
+        std::string operator () (std::nullptr_t) const { return "null"; }
+        std::string operator () (bool v) const { return v ? "true" : "false"; }
+        std::string operator () (std::int64_t v) const { return std::to_string(v); }
+        std::string operator () (std::uint64_t v) const { return std::to_string(v); }
+        std::string operator () (double v) const {
+            std::string text = std::to_string(v);
+            text.erase(text.find_last_not_of('0') + 1);
+            if (text.back() == '.') text.pop_back();
+            return text;
+        }
+        std::string operator () (const std::string& v) const { return '"' + v + '"'; }
+        std::string operator () (const Bytes& v) const { return "<" + std::to_string(v.data.size()) + " bytes>"; }
+        std::string operator () (const Members& v) const {
+            std::string text = "{";
+            for (auto& [key, item] : v) {
+                if (text.size() > 1) text += ',';
+                text += '"' + key + "\":" + json(*item);
+            }
+            return text + '}';
+        }
+        std::string operator () (const Elements& v) const {
+            std::string text = "[";
+            for (auto& item : v) {
+                if (text.size() > 1) text += ',';
+                text += json(*item);
+            }
+            return text + ']';
+        }
+    };
+    return std::visit(Visitor(), v.data);
+}
+
+struct Options {
+    using error_mode = Clio::ErrorMode::Throw;
+    using map_layout = Clio::MapLayout::Objects;
+    static constexpr bool identities = false;
+};
+
+struct Recording : Options {
+    using error_mode = Clio::ErrorMode::Record;
+};
+
+struct Sharing : Options {
+    static constexpr bool identities = true;
+};
+
+template <typename Settings = Options>
+class DocumentWriter : public Clio::Serializer<DocumentWriter<Settings>> {
+    CLIO_SERIALIZER(DocumentWriter)
+    using map_layout = typename Settings::map_layout;
+
+    const std::shared_ptr<Value>& document() const noexcept { return root; }
+    std::string json() const { return Test::json(*root); }
+
+    template <typename Type = Settings>
+    std::enable_if_t<Type::identities, Clio::Identities&> identities() { return table; }
+
+protected:
+    void write(std::nullptr_t) { slot() = Value { nullptr }; }
+    void write(bool v) { slot() = Value { v }; }
+    template <typename Type>
+    std::enable_if_t<std::is_integral_v<Type>> write(Type v) {
+        if constexpr (std::is_signed_v<Type>) {
+            slot() = Value { static_cast<std::int64_t>(v) };
+        }
+        else {
+            slot() = Value { static_cast<std::uint64_t>(v) };
+        }
+    }
+    void write(double v) { slot() = Value { v }; }
+    void write(float v) { slot() = Value { double(v) }; }
+    void write(const std::string& v) {
+        if (!stack.empty()) {
+            if (auto bytes = std::get_if<Bytes>(&stack.back()->data)) {
+                bytes->data += v;
+                return;
+            }
+        }
+        slot() = Value { v };
+    }
+    void writeKey(std::string_view key) { pending = key; }
+
+    void beginObject() { open(Members()); }
+    void endObject() { stack.pop_back(); }
+    void beginArray() { open(Elements()); }
+    void endArray() { stack.pop_back(); }
+    void beginBlob() { open(Bytes()); }
+    void endBlob() { stack.pop_back(); }
+
+private:
+    template <typename Type>
+    void open(Type&& container) {
+        Value& v = slot();
+        v.data = std::forward<Type>(container);
+        stack.push_back(&v);
+    }
+
+    Value& slot() {
+        if (stack.empty()) return *root;
+        auto item = std::make_shared<Value>();
+        if (auto members = std::get_if<Members>(&stack.back()->data)) {
+            members->emplace_back(pending, item);
+        }
+        else {
+            std::get<Elements>(stack.back()->data).push_back(item);
+        }
+        return *item;
+    }
+
+    std::shared_ptr<Value> root = std::make_shared<Value>();
+    std::vector<Value*> stack;
+    std::string pending;
+    Clio::Identities table;
+};
+
+template <typename Settings = Options>
+class DocumentReader : public Clio::Deserializer<DocumentReader<Settings>> {
+    CLIO_DESERIALIZER(DocumentReader)
+    using error_mode = typename Settings::error_mode;
+    using map_layout = typename Settings::map_layout;
+
+    explicit DocumentReader(std::shared_ptr<Value> document) : tree(std::move(document)) {}
+
+    template <typename Type = Settings>
+    std::enable_if_t<Type::identities, Clio::Identities&> identities() { return table; }
+
+    // Positions predicted by the shape cache, and how many of them were right
+    struct Hints {
+        std::size_t predicted = 0;
+        std::size_t hits = 0;
+    };
+    const Hints& hints() const noexcept { return counts; }
+
+protected:
+    void read(std::nullptr_t&) { expect<std::nullptr_t>(); }
+    void read(bool& v) {
+        if (auto p = expect<bool>()) v = *p;
+    }
+    template <typename Type>
+    std::enable_if_t<std::is_integral_v<Type>> read(Type& v) {
+        const Value& item = next();
+        if (auto p = std::get_if<std::int64_t>(&item.data)) v = static_cast<Type>(*p);
+        else if (auto q = std::get_if<std::uint64_t>(&item.data)) v = static_cast<Type>(*q);
+        else mismatch();
+    }
+    void read(double& v) {
+        const Value& item = next();
+        if (auto p = std::get_if<double>(&item.data)) v = *p;
+        else if (auto q = std::get_if<std::int64_t>(&item.data)) v = double(*q);
+        else if (auto r = std::get_if<std::uint64_t>(&item.data)) v = double(*r);
+        else mismatch();
+    }
+    void read(std::string& v) {
+        if (!stack.empty()) {
+            if (auto bytes = std::get_if<Bytes>(&stack.back().value->data)) {
+                v = bytes->data;
+                return;
+            }
+        }
+        if (auto p = expect<std::string>()) v = *p;
+    }
+
+    const std::string& peekKey() const {
+        const Frame& top = stack.back();
+        return std::get<Members>(top.value->data).at(top.cursor).first;
+    }
+    bool hasKey(std::string_view key) const {
+        for (auto& member : std::get<Members>(stack.back().value->data)) {
+            if (member.first == key) return true;
+        }
+        return false;
+    }
+    void readKey(std::string_view key) {
+        readKey(key, npos);
+    }
+    // The key at the predicted position is checked first, then the object is searched
+    std::size_t readKey(std::string_view key, std::size_t position) {
+        Frame& top = stack.back();
+        auto& members = std::get<Members>(top.value->data);
+        if (position != npos) {
+            counts.predicted++;
+            if (position < members.size() && members[position].first == key) counts.hits++;
+            else position = npos;
+        }
+        for (std::size_t i = 0; position == npos && i < members.size(); ++i) {
+            if (members[i].first == key) position = i;
+        }
+        if (position == npos) {
+            raise(Clio::errc::missing_key, "Missing key: " + std::string(key));
+            return npos;
+        }
+        selected = members[position].second.get();
+        top.cursor = position + 1;
+        return position;
+    }
+
+    Clio::Kind kind() const {
+        const Value* item = selected;
+        if (!item && stack.empty()) item = tree.get();
+        if (!item) {
+            const Frame& top = stack.back();
+            if (auto members = std::get_if<Members>(&top.value->data)) item = members->at(top.cursor).second.get();
+            else item = std::get<Elements>(top.value->data).at(top.cursor).get();
+        }
+        switch (item->data.index()) {
+        case 0: return Clio::Kind::Null;
+        case 1: return Clio::Kind::Bool;
+        case 2: return Clio::Kind::Integer;
+        case 3: return Clio::Kind::Unsigned;
+        case 4: return Clio::Kind::Floating;
+        case 5: return Clio::Kind::String;
+        case 6: return Clio::Kind::Object;
+        case 7: return Clio::Kind::Array;
+        default: return Clio::Kind::Blob;
+        }
+    }
+
+    void seek(std::size_t index) { stack.back().cursor = index; }
+
+    void beginObject() { open<Members>(); }
+    void endObject() { stack.pop_back(); }
+    void beginArray() { open<Elements>(); }
+    void endArray() { stack.pop_back(); }
+    void beginBlob() { open<Bytes>(); }
+    void endBlob() { stack.pop_back(); }
+
+    std::size_t size() const {
+        const Value* top = stack.back().value;
+        if (auto members = std::get_if<Members>(&top->data)) return members->size();
+        return std::get<Elements>(top->data).size();
+    }
+
+private:
+    static constexpr std::size_t npos = Clio::Deserialization::Shape::npos;
+
+    struct Frame {
+        const Value* value;
+        std::size_t cursor = 0;
+    };
+
+    const Value& next() {
+        if (selected) return *std::exchange(selected, nullptr);
+        if (stack.empty()) return *tree;
+        Frame& top = stack.back();
+        auto& elements = std::get<Elements>(top.value->data);
+        if (top.cursor >= elements.size()) {
+            raise(Clio::errc::unexpected_end, "Read past the end of an array");
+            return empty;
+        }
+        return *elements[top.cursor++];
+    }
+
+    template <typename Type>
+    const Type* expect() {
+        const Type* v = std::get_if<Type>(&next().data);
+        if (!v) mismatch();
+        return v;
+    }
+
+    template <typename Type>
+    void open() {
+        const Value& item = next();
+        if (std::holds_alternative<Type>(item.data)) {
+            stack.push_back({ &item });
+            return;
+        }
+        mismatch();
+        // Carry on with an empty container, a recording deserializer won't look into it anyway
+        static const Value blank { Type() };
+        stack.push_back({ &blank });
+    }
+
+    void mismatch() { raise(Clio::errc::type_mismatch, "Type mismatch"); }
+
+    void raise(Clio::errc code, const std::string& message) {
+        if constexpr (Clio::records_errors_v<DocumentReader>) {
+            this->fail(code);
+        }
+        else {
+            throw std::runtime_error(message);
+        }
+    }
+
+    std::shared_ptr<Value> tree;
+    std::vector<Frame> stack;
+    const Value* selected = nullptr;
+    Value empty;
+    Clio::Identities table;
+    Hints counts;
+};
+
+// Serializes the value and deserializes it back into a new one
+template <typename Type, typename Settings = Options, typename ... Arguments>
+Type roundtrip(const Type& v, Arguments&& ... args) {
+    DocumentWriter<Settings> writer;
+    writer.value(v, args...);
+    DocumentReader<Settings> reader(writer.document());
+    return reader.template root<Type>(std::forward<Arguments>(args)...);
+}
+}
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <iostream>
+#include <exception>
+
+// Minimal checks for the test executables: failures are counted and printed, and main() returns the count.
+namespace Test {
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void report(const char* file, int line, const char* expression) {
+    std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+    failures()++;
+}
+}
+
+#define CHECK(condition) \
+    do { if (!(condition)) Test::report(__FILE__, __LINE__, #condition); } while (false)
+
+#define CHECK_THROWS(expression) \
+    do { \
+        bool thrown = false; \
+        try { expression; } catch (const std::exception&) { thrown = true; } \
+        if (!thrown) Test::report(__FILE__, __LINE__, "throws: " #expression); \
+    } while (false)
+
+#define CHECK_NOTHROW(expression) \
+    do { \
+        try { expression; } catch (const std::exception& e) { Test::report(__FILE__, __LINE__, e.what()); } \
+    } while (false)
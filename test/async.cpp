@@ -0,0 +1,182 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include <clio/Serializer.h>
+#include <clio/Async.h>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+// Writes at most chunk bytes per flush, as a socket with a small send buffer would
+struct Sink {
+    std::size_t pending() const { return buffer.size(); }
+    std::size_t flush() {
+        flushes++;
+        std::size_t count = std::min(chunk, buffer.size());
+        written.append(buffer, 0, count);
+        buffer.erase(0, count);
+        return buffer.size();
+    }
+    std::size_t watermark() const { return limit; }
+    int descriptor() const { return 0; }
+
+    std::string buffer, written;
+    std::size_t chunk = 16, limit = 32, flushes = 0;
+};
+
+// Sends to a non-blocking socket, keeping what the socket doesn't take
+struct SocketSink {
+    std::size_t pending() const { return buffer.size(); }
+    std::size_t flush() {
+        while (!buffer.empty()) {
+            ssize_t count = ::send(socket, buffer.data(), buffer.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) throw std::system_error(errno, std::generic_category(), "Can't send");
+                blocked++;
+                break;
+            }
+            buffer.erase(0, static_cast<std::size_t>(count));
+        }
+        return buffer.size();
+    }
+    std::size_t watermark() const { return 16 * 1024; }
+    int descriptor() const { return socket; }
+
+    int socket = -1;
+    std::string buffer;
+    std::atomic<std::size_t> blocked = 0;   // Flushes cut short by a full socket
+};
+
+class TextSerializer : public Clio::Serializer<TextSerializer> {
+    CLIO_SERIALIZER(TextSerializer)
+
+    explicit TextSerializer(std::string& output) : buffer(output) {}
+
+protected:
+    void write(int v) {
+        if (v < 0) throw std::runtime_error("Negative");
+        separate();
+        buffer += std::to_string(v);
+    }
+    void beginArray() {
+        separate();
+        buffer += '[';
+        first = true;
+    }
+    void endArray() {
+        buffer += ']';
+        first = false;
+    }
+
+private:
+    void separate() {
+        if (!first) buffer += ',';
+        first = false;
+    }
+
+    std::string& buffer;
+    bool first = true;
+};
+}
+
+int main() {
+    // Small elements: the sink is flushed only when it goes over the watermark
+    {
+        std::vector<int> values(100, 7);
+        Sink sink;
+        TextSerializer s(sink.buffer);
+        Clio::Async::LocalLoop loop;
+        loop.spawn(Clio::Async::serialize_sequence(loop, sink, s, values));
+        loop.run();
+
+        std::string expected = "[7";
+        for (int i = 1; i < 100; ++i) expected += ",7";
+        expected += ']';
+        CHECK(sink.written == expected);
+        CHECK(sink.buffer.empty());
+        CHECK(sink.flushes < values.size() / 2);
+    }
+    // Interleaved streams share the loop and finish independently
+    {
+        std::vector<int> a(50, 1), b(20, 22);
+        Sink first, second;
+        TextSerializer s1(first.buffer), s2(second.buffer);
+        Clio::Async::LocalLoop loop;
+        loop.spawn(Clio::Async::serialize_sequence(loop, first, s1, a));
+        loop.spawn(Clio::Async::serialize_sequence(loop, second, s2, b));
+        CHECK(!loop.empty());
+        loop.run();
+        CHECK(first.written.size() == 2 * 50 + 1);
+        CHECK(second.written.size() == 3 * 20 + 1);
+    }
+    // Exceptions from the serializer propagate out of the loop
+    {
+        std::vector<int> values(40, 5);
+        values[30] = -1;
+        Sink sink;
+        TextSerializer s(sink.buffer);
+        Clio::Async::LocalLoop loop;
+        CHECK_THROWS({
+            loop.spawn(Clio::Async::serialize_sequence(loop, sink, s, values));
+            loop.run();
+        });
+    }
+    // Through a socket: the payload is larger than the socket buffers, so the writer waits on epoll for the reader
+    {
+        int sockets[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+            Test::report(__FILE__, __LINE__, "socketpair()");
+            return Test::failures();
+        }
+        int size = 16 * 1024;
+        ::setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        ::setsockopt(sockets[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+        std::vector<int> values(300000);
+        for (std::size_t i = 0; i < values.size(); ++i) values[i] = static_cast<int>(i * 7919 % 100003);
+        std::string expected = "[";
+        for (std::size_t i = 0; i < values.size(); ++i) expected += (i ? "," : "") + std::to_string(values[i]);
+        expected += ']';
+
+        SocketSink sink;
+        sink.socket = sockets[0];
+        std::atomic<bool> done = false;
+        std::string received;
+        std::thread reader([&] () {
+            // Reads only once the writer has filled the socket up, or has finished
+            while (!sink.blocked && !done) std::this_thread::yield();
+            char chunk[4096];
+            for (;;) {
+                ssize_t count = ::read(sockets[1], chunk, sizeof(chunk));
+                if (count > 0) received.append(chunk, static_cast<std::size_t>(count));
+                else if (count == 0 || errno != EINTR) break;
+            }
+        });
+
+        TextSerializer s(sink.buffer);
+        Clio::Async::EpollLoop loop;
+        CHECK_NOTHROW({
+            loop.spawn(Clio::Async::serialize_sequence(loop, sink, s, values));
+            loop.run();
+        });
+        done = true;
+        ::close(sockets[0]);
+        reader.join();
+        ::close(sockets[1]);
+
+        CHECK(sink.blocked > 0);
+        CHECK(sink.buffer.empty());
+        CHECK(received.size() == expected.size());
+        CHECK(received == expected);
+    }
+    return Test::failures();
+}
@@ -0,0 +1,43 @@
+# Generates a translation unit with the given number of serializable types, each with the given number of fields,
+# so that the capability detection of the serializer and the deserializer is exercised for every field.
+function(clio_generate_benchmark output types fields)
+    set(field_types "int" "double" "std::string" "std::vector<int>" "std::map<std::string, int>" "std::optional<long>")
+    list(LENGTH field_types kinds)
+    math(EXPR last_type "${types} - 1")
+    math(EXPR last_field "${fields} - 1")
+
+    set(source "// Generated by generate.cmake (${types} types x ${fields} fields), do not edit\n")
+    string(APPEND source "#include \"Document.h\"\n#include <clio/helper/vector.h>\n#include <clio/helper/map.h>\n#include <optional>\n")
+    foreach(t RANGE ${last_type})
+        set(members "")
+        set(writes "")
+        set(reads "")
+        foreach(f RANGE ${last_field})
+            math(EXPR k "(${t} + ${f}) % ${kinds}")
+            list(GET field_types ${k} type)
+            string(APPEND members "    ${type} field${f} {};\n")
+            string(APPEND writes "    object.value(\"field${f}\", v.field${f});\n")
+            string(APPEND reads "    object.value(\"field${f}\", v.field${f});\n")
+        endforeach()
+        string(APPEND source "
+struct Type${t} {
+${members}};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Type${t}& v) {
+    auto object = s.object();
+${writes}}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Type${t}& v) {
+    auto object = d.object();
+${reads}}
+
+Type${t} roundtrip${t}(const Type${t}& v) { return Test::roundtrip(v); }
+")
+    endforeach()
+
+    # Only touch the file when the content changes, so the targets using it aren't rebuilt needlessly
+    file(WRITE "${output}.tmp" "${source}")
+    configure_file("${output}.tmp" "${output}" COPYONLY)
+endfunction()
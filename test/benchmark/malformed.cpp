@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+// Deserialization of valid and malformed records, with errors thrown and with errors recorded.
+// Usage: malformed_benchmark [iterations]
+#include "Document.h"
+#include <clio/helper/array.h>
+#include <clio/helper/vector.h>
+#include <clio/helper/packed.h>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+struct Record {
+    int id = 0;
+    std::string name;
+    std::array<int, 4> bounds {};
+    std::vector<double> samples;
+    std::vector<std::uint32_t> timestamps;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Record& v) {
+    auto object = s.object();
+    object.value("id", v.id);
+    object.value("name", v.name);
+    object.value("bounds", v.bounds);
+    object.value("samples", v.samples);
+    object.value("timestamps", v.timestamps, Clio::Packed::delta);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Record& v) {
+    auto object = d.object();
+    object.value("id", v.id);
+    object.value("name", v.name);
+    object.value("bounds", v.bounds);
+    object.value("samples", v.samples);
+    object.value("timestamps", v.timestamps, Clio::Packed::delta);
+}
+
+struct Input {
+    const char* name;
+    std::shared_ptr<Test::Value> document;
+    bool malformed = true;
+};
+
+Record sample() {
+    Record v { 42, "sensor", { 0, 0, 640, 480 }, {}, {} };
+    for (int i = 0; i < 64; ++i) v.samples.push_back(i * 0.5);
+    for (std::uint32_t i = 0; i < 256; ++i) v.timestamps.push_back(1700000000 + i * 10);
+    return v;
+}
+
+std::shared_ptr<Test::Value> valid() {
+    Test::DocumentWriter<> writer;
+    writer.value(sample());
+    return writer.document();
+}
+
+// The sample with one member replaced
+std::shared_ptr<Test::Value> corrupt(const std::string& key, std::shared_ptr<Test::Value> value) {
+    auto document = valid();
+    for (auto& member : std::get<Test::Members>(document->data)) {
+        if (member.first == key) member.second = std::move(value);
+    }
+    return document;
+}
+
+std::vector<Input> inputs() {
+    Test::Elements bounds;
+    for (std::int64_t i = 0; i < 5; ++i) bounds.push_back(Test::make(i));
+    Test::Elements samples;
+    for (int i = 0; i < 64; ++i) samples.push_back(i == 32 ? Test::make(std::string("nan")) : Test::make(i * 0.5));
+
+    return {
+        { "valid", valid(), false },
+        { "type mismatch (first field)", corrupt("id", Test::make(std::string("42"))) },
+        { "size mismatch (fixed array)", corrupt("bounds", Test::make(bounds)) },
+        { "type mismatch (mid sequence)", corrupt("samples", Test::make(samples)) },
+        // Delta coded, 2^40 equal elements in 10 bytes
+        { "packed count (2^40)", corrupt("timestamps", Test::make(Test::Bytes { std::string("\x01\x80\x80\x80\x80\x80\x20\x00\x00\x00", 10) })) },
+        { "packed truncated", corrupt("timestamps", Test::make(Test::Bytes { std::string("\x01\xFF\x01\x00\x00\x20", 6) })) },
+    };
+}
+
+template <typename Settings>
+double measure(const Input& input, std::size_t iterations, std::size_t& failures) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        Test::DocumentReader<Settings> reader(input.document);
+        if constexpr (Clio::records_errors_v<Test::DocumentReader<Settings>>) {
+            reader.template root<Record>();
+            failures += reader.failed();
+        }
+        else {
+            try {
+                reader.template root<Record>();
+            }
+            catch (const std::exception&) {
+                failures++;
+            }
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / double(iterations);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (!iterations) iterations = 1;
+
+    int status = 0;
+    std::printf("%-32s %14s %14s\n", "input", "throw ns/op", "record ns/op");
+    for (auto& input : inputs()) {
+        std::size_t thrown = 0, recorded = 0;
+        double throwing = measure<Test::Options>(input, iterations, thrown);
+        double recording = measure<Test::Recording>(input, iterations, recorded);
+        std::printf("%-32s %14.1f %14.1f\n", input.name, throwing, recording);
+
+        // Both modes have to agree on what's malformed
+        std::size_t expected = input.malformed ? iterations : 0;
+        if (thrown != expected || recorded != expected) {
+            std::printf("  unexpected result: %zu thrown, %zu recorded, expecting %zu\n", thrown, recorded, expected);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,57 @@
+# Compiles the generated benchmark with the requires-expression based detection and with the void_t based one (CLIO_NO_CONCEPTS),
+# and reports the best of RUNS compile times along with what the compiler can tell about template instantiation:
+# the number of class and function instantiations for Clang (-ftime-trace), the time spent instantiating for GCC (-ftime-report).
+#   cmake -DCOMPILER=... -DCOMPILER_ID=... -DSOURCE=... -DINCLUDE_DIRS=dir1,dir2 -DWORK=... -DRUNS=3 -P measure.cmake
+cmake_minimum_required(VERSION 3.23)
+
+string(REPLACE "," ";" include_dirs "${INCLUDE_DIRS}")
+set(includes "")
+foreach(directory ${include_dirs})
+    list(APPEND includes "-I${directory}")
+endforeach()
+if(NOT RUNS)
+    set(RUNS 3)
+endif()
+
+foreach(variant concepts traits)
+    set(flags -std=c++20 ${includes} -c "${SOURCE}" -o "${WORK}/${variant}.o")
+    if(variant STREQUAL "traits")
+        list(APPEND flags -DCLIO_NO_CONCEPTS)
+    endif()
+    if(COMPILER_ID MATCHES "Clang")
+        list(APPEND flags -ftime-trace -ftime-trace-granularity=0)
+    elseif(COMPILER_ID STREQUAL "GNU")
+        list(APPEND flags -ftime-report)
+    endif()
+
+    set(best "")
+    foreach(run RANGE 1 ${RUNS})
+        string(TIMESTAMP start "%s%f" UTC)
+        execute_process(COMMAND "${COMPILER}" ${flags} RESULT_VARIABLE result ERROR_VARIABLE report)
+        string(TIMESTAMP end "%s%f" UTC)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "Compiling the ${variant} variant failed:\n${report}")
+        endif()
+        math(EXPR elapsed "(${end} - ${start}) / 1000")
+        if(best STREQUAL "" OR elapsed LESS best)
+            set(best ${elapsed})
+        endif()
+    endforeach()
+
+    set(details "")
+    if(COMPILER_ID MATCHES "Clang")
+        file(READ "${WORK}/${variant}.json" trace)
+        string(REGEX MATCHALL "\"name\":\"InstantiateClass\"" classes "${trace}")
+        string(REGEX MATCHALL "\"name\":\"InstantiateFunction\"" functions "${trace}")
+        list(LENGTH classes class_count)
+        list(LENGTH functions function_count)
+        set(details ", ${class_count} class and ${function_count} function instantiations")
+    elseif(COMPILER_ID STREQUAL "GNU")
+        string(REGEX MATCH "template instantiation[^\n]*" instantiation "${report}")
+        if(instantiation)
+            string(REGEX REPLACE "[ \t]+" " " instantiation "${instantiation}")
+            set(details ", ${instantiation}")
+        endif()
+    endif()
+    message(STATUS "${variant}: ${best} ms${details}")
+endforeach()
@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include <clio/BufferPool.h>
+#include <clio/Serializer.h>
+#include <clio/helper/vector.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Counts the allocations, for the steady state check
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+// Reports the capacity it was given without allocating it
+struct Buffer {
+    std::size_t capacity() const noexcept { return reserved; }
+    void reserve(std::size_t size) { reserved = std::max(reserved, size); }
+    void clear() noexcept { used = 0; }
+
+    std::size_t reserved = 0;
+    std::size_t used = 0;
+};
+
+using Pool = Clio::BufferPool<Buffer>;
+
+Buffer sized(std::size_t capacity) {
+    Buffer buffer;
+    buffer.reserve(capacity);
+    return buffer;
+}
+
+// Appends its output to the buffer it's given, without allocating anything of its own
+class TextWriter : public Clio::Serializer<TextWriter> {
+    CLIO_SERIALIZER(TextWriter)
+
+    explicit TextWriter(std::string& buffer) : output(buffer) {}
+
+protected:
+    void write(int v) {
+        char digits[16];
+        output.append(digits, std::to_chars(digits, digits + sizeof(digits), v).ptr);
+        output += ' ';
+    }
+    void write(const std::string& v) {
+        output += '"';
+        output += v;
+        output += '"';
+    }
+    void writeKey(std::string_view key) {
+        output += key;
+        output += ':';
+    }
+
+    void beginObject() { output += '{'; }
+    void endObject() { output += '}'; }
+    void beginArray() { output += '['; }
+    void endArray() { output += ']'; }
+
+private:
+    std::string& output;
+};
+
+struct Message {
+    int id = 0;
+    std::string text;
+    std::vector<int> values;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Message& v) {
+    auto object = s.object();
+    object.value("id", v.id);
+    object.value("text", v.text);
+    object.value("values", v.values);
+}
+
+// The consumer, which gets the lease and lets the buffer go back to the pool once it's done with it
+std::size_t sent = 0;
+
+void send(Clio::BufferPool<std::string>::Lease lease) {
+    sent += lease->size();
+}
+}
+
+int main() {
+    constexpr std::size_t largest = Pool::minimumCapacity << (Pool::classes - 1);
+    {
+        // Requests are rounded up to their size class, and served again from it
+        Pool pool;
+        Buffer buffer = pool.acquire(1000).detach();
+        CHECK(buffer.capacity() == 1024);
+        pool.release(std::move(buffer));
+        CHECK(pool.statistics().retained == 1);
+        CHECK(pool.acquire(600)->capacity() == 1024);
+        CHECK(pool.statistics().hits == 1 && pool.statistics().misses == 1);
+    }
+    {
+        // Buffers are filed under the largest class they fully cover
+        Pool pool;
+        pool.release(sized(1500));
+        CHECK(pool.acquire(1024)->capacity() == 1500);
+        CHECK(pool.statistics().hits == 1);
+        pool.release(sized(1500));
+        CHECK(pool.acquire(1025)->capacity() == 2048);
+        CHECK(pool.statistics().misses == 1);
+    }
+    {
+        // Buffers up to the largest class are kept, larger ones are dropped
+        Pool pool;
+        pool.release(sized(largest));
+        CHECK(pool.statistics().retained == 1);
+        pool.release(sized(largest + largest / 4));
+        pool.release(sized(2 * largest));
+        pool.release(sized(Pool::minimumCapacity - 1));
+        CHECK(pool.statistics().retained == 1);
+        CHECK(pool.statistics().retainedBytes == largest);
+    }
+    {
+        // Each class holds a limited number of buffers, trim() frees them all
+        Pool pool;
+        for (std::size_t i = 0; i < Pool::buffersPerClass + 4; ++i) pool.release(sized(4096));
+        CHECK(pool.statistics().retained == Pool::buffersPerClass);
+        pool.trim();
+        CHECK(pool.statistics().retained == 0 && pool.statistics().retainedBytes == 0);
+    }
+    {
+        // Leases go back to the thread's pool
+        auto& pool = Clio::BufferPool<std::string>::local();
+        {
+            auto lease = pool.acquire(300);
+            lease->append("payload");
+        }
+        CHECK(pool.statistics().retained == 1);
+        auto lease = pool.acquire(300);
+        CHECK(lease->empty() && lease->capacity() >= 300);
+        CHECK(pool.statistics().hits == 1);
+    }
+    {
+        // Once warmed up, serializing into leased buffers allocates nothing
+        auto& pool = Clio::BufferPool<std::string>::local();
+        const Message message { 42, std::string(300, 'm'), std::vector<int>(200, 7) };
+        auto serialize = [&pool, &message] () {
+            auto lease = pool.acquire(1024);
+            TextWriter s(*lease);
+            s.value(message);
+            send(std::move(lease));
+        };
+        for (int i = 0; i < 3; ++i) serialize();
+        std::size_t size = sent / 3;
+        CHECK(size > 700 && size <= 1024);
+
+        auto hits = pool.statistics().hits;
+        std::size_t before = allocations;
+        for (int i = 0; i < 100; ++i) serialize();
+        CHECK(allocations == before);
+        CHECK(pool.statistics().hits == hits + 100);
+        CHECK(sent == 103 * size);
+    }
+
+    return Test::failures();
+}
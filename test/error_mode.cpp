@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/array.h>
+#include <clio/helper/pair.h>
+#include <clio/helper/vector.h>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace {
+struct Record {
+    int id = 0;
+    std::string name;
+    std::array<int, 3> triple {};
+    std::vector<int> values;
+    std::pair<int, std::string> tag;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Record& v) {
+    auto object = s.object();
+    object.value("id", v.id);
+    object.value("name", v.name);
+    object.value("triple", v.triple);
+    object.value("values", v.values);
+    object.value("tag", v.tag);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Record& v) {
+    auto object = d.object();
+    object.value("id", v.id);
+    object.value("name", v.name);
+    object.value("triple", v.triple);
+    object.value("values", v.values);
+    object.value("tag", v.tag);
+}
+
+const Record sample { 7, "seven", { 1, 2, 3 }, { 4, 5, 6, 7 }, { 8, "eight" } };
+
+// The sample with one member replaced
+std::shared_ptr<Test::Value> corrupt(const std::string& key, std::shared_ptr<Test::Value> value) {
+    Test::DocumentWriter<> writer;
+    writer.value(sample);
+    auto document = writer.document();
+    for (auto& member : std::get<Test::Members>(document->data)) {
+        if (member.first == key) member.second = std::move(value);
+    }
+    return document;
+}
+
+std::shared_ptr<Test::Value> integers(std::initializer_list<std::int64_t> items) {
+    Test::Elements elements;
+    for (auto item : items) elements.push_back(Test::make(item));
+    return Test::make(std::move(elements));
+}
+
+std::string message(const std::shared_ptr<Test::Value>& document) {
+    try {
+        Test::DocumentReader<> reader(document);
+        reader.root<Record>();
+    }
+    catch (const std::exception& e) {
+        return e.what();
+    }
+    return std::string();
+}
+}
+
+int main() {
+    {
+        // Valid input reads back without an error being recorded
+        Test::DocumentWriter<> writer;
+        writer.value(sample);
+        Test::DocumentReader<Test::Recording> reader(writer.document());
+        Record v = reader.root<Record>();
+        CHECK(!reader.failed());
+        CHECK(v.id == 7 && v.name == "seven" && v.triple[2] == 3 && v.values.size() == 4 && v.tag.second == "eight");
+    }
+    {
+        // The first error is kept and the rest of the input is skipped
+        Test::DocumentReader<Test::Recording> reader(corrupt("id", Test::make(std::string("x"))));
+        Record v;
+        CHECK_NOTHROW(v = reader.root<Record>());
+        CHECK(reader.error() == Clio::errc::type_mismatch);
+        CHECK(v.name.empty() && v.values.empty() && v.tag.first == 0);
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(corrupt("triple", integers({ 1, 2, 3, 4 })));
+        Record v;
+        CHECK_NOTHROW(v = reader.root<Record>());
+        CHECK(reader.error() == Clio::errc::size_mismatch);
+        CHECK(v.name == "seven" && v.triple[0] == 0 && v.values.empty());
+        CHECK(message(corrupt("triple", integers({ 1, 2, 3, 4 }))) == "Fixed-size array size mismatch: expecting 3, got 4");
+    }
+    {
+        // Sequences stop at the failing element
+        Test::Elements values { Test::make(std::int64_t(1)), Test::make(std::string("two")), Test::make(std::int64_t(3)) };
+        Test::DocumentReader<Test::Recording> reader(corrupt("values", Test::make(values)));
+        Record v;
+        CHECK_NOTHROW(v = reader.root<Record>());
+        CHECK(reader.error() == Clio::errc::type_mismatch);
+        CHECK(v.values.size() == 2 && v.values[0] == 1);
+        CHECK(v.tag.second.empty());
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(corrupt("tag", integers({ 1 })));
+        CHECK_NOTHROW(reader.root<Record>());
+        CHECK(reader.error() == Clio::errc::size_mismatch);
+        CHECK_THROWS(Test::DocumentReader<>(corrupt("tag", integers({ 1 }))).root<Record>());
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(corrupt("name", Test::make(Test::Members())));
+        CHECK_NOTHROW(reader.root<Record>());
+        CHECK(reader.error() == Clio::errc::type_mismatch);
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(Test::make(Test::Members()));
+        CHECK_NOTHROW(reader.root<Record>());
+        CHECK(reader.error() == Clio::errc::missing_key);
+        CHECK(message(Test::make(Test::Members())) == "Missing key: id");
+
+        // Later failures don't replace the first one, and failed deserializers report empty containers
+        reader.fail(Clio::errc::invalid_data);
+        CHECK(reader.error() == Clio::errc::missing_key);
+        CHECK(reader.array().size() == 0);
+    }
+
+    return Test::failures();
+}
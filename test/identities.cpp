@@ -0,0 +1,168 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/memory.h>
+#include <clio/helper/vector.h>
+#include <memory>
+#include <cstdint>
+#include <vector>
+
+namespace {
+struct RecordingShared : Test::Sharing {
+    using error_mode = Clio::ErrorMode::Record;
+};
+
+struct Foo {
+    int x = 0;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Foo& v) {
+    auto object = s.object();
+    object.value("x", v.x);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Foo& v) {
+    auto object = d.object();
+    object.value("x", v.x);
+}
+
+// The member has the same address as the object it's in
+struct Outer {
+    Foo inner;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Outer& v) {
+    auto object = s.object();
+    object.value("inner", v.inner);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Outer& v) {
+    auto object = d.object();
+    object.value("inner", v.inner);
+}
+
+struct Holder {
+    std::shared_ptr<Outer> outer;
+    std::shared_ptr<Foo> inner;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Holder& v) {
+    auto object = s.object();
+    object.value("outer", v.outer);
+    object.value("inner", v.inner);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Holder& v) {
+    auto object = d.object();
+    object.value("outer", v.outer);
+    object.value("inner", v.inner);
+}
+
+struct Link {
+    int value = 0;
+    std::shared_ptr<Link> next;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Link& v) {
+    auto object = s.object();
+    object.value("value", v.value);
+    object.value("next", v.next);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Link& v) {
+    auto object = d.object();
+    object.value("value", v.value);
+    object.value("next", v.next);
+}
+}
+
+int main() {
+    {
+        // Repeated objects are written once and read back shared
+        auto foo = std::make_shared<Foo>(Foo { 3 });
+        std::vector<std::shared_ptr<Foo>> v { foo, nullptr, foo };
+        Test::DocumentWriter<Test::Sharing> writer;
+        writer.value(v);
+        CHECK(writer.json() == R"([{"id":0,"value":{"x":3}},{},{"ref":0}])");
+
+        Test::DocumentReader<Test::Sharing> reader(writer.document());
+        auto copy = reader.root<std::vector<std::shared_ptr<Foo>>>();
+        CHECK(copy.size() == 3 && copy[0] == copy[2] && !copy[1] && copy[0]->x == 3);
+        CHECK(reader.identities().size() == 1);
+
+        // Without a table each occurrence is written in full
+        Test::DocumentWriter<> plain;
+        plain.value(v);
+        CHECK(plain.json() == R"([{"value":{"x":3}},{},{"value":{"x":3}}])");
+    }
+    {
+        // Cycles
+        auto first = std::make_shared<Link>(Link { 1, nullptr });
+        first->next = std::make_shared<Link>(Link { 2, first });
+        Test::DocumentWriter<Test::Sharing> writer;
+        writer.value(first);
+        CHECK(writer.json() == R"({"id":0,"value":{"value":1,"next":{"id":1,"value":{"value":2,"next":{"ref":0}}}}})");
+
+        Test::DocumentReader<Test::Sharing> reader(writer.document());
+        auto copy = reader.root<std::shared_ptr<Link>>();
+        CHECK(copy && copy->next && copy->next->next == copy && copy->next->value == 2);
+
+        copy->next->next.reset();
+        first->next->next.reset();
+        reader.identities().clear();
+        writer.identities().clear();
+    }
+    {
+        // The table keeps the objects alive, a new object can't take the address of a listed one
+        Test::DocumentWriter<Test::Sharing> writer;
+        writer.value(std::make_shared<Foo>(Foo { 1 }));
+        writer.value(std::make_shared<Foo>(Foo { 2 }));
+        CHECK(writer.json() == R"({"id":1,"value":{"x":2}})");
+    }
+    {
+        // An object and its member (or an aliasing pointer) share the address, but not the type
+        auto outer = std::make_shared<Outer>(Outer { Foo { 5 } });
+        Holder holder { outer, std::shared_ptr<Foo>(outer, &outer->inner) };
+        Test::DocumentWriter<Test::Sharing> writer;
+        writer.value(holder);
+        CHECK(writer.json() == R"({"outer":{"id":0,"value":{"inner":{"x":5}}},"inner":{"id":1,"value":{"x":5}}})");
+
+        Test::DocumentReader<Test::Sharing> reader(writer.document());
+        Holder copy;
+        CHECK_NOTHROW(copy = reader.root<Holder>());
+        CHECK(copy.outer && copy.inner && copy.inner->x == 5);
+    }
+    {
+        // Malformed references and ids
+        auto unknown = Test::make(Test::Members { { "ref", Test::make(std::uint64_t(4)) } });
+        Test::DocumentReader<Test::Sharing> throwing(unknown);
+        CHECK_THROWS(throwing.root<std::shared_ptr<Foo>>());
+        Test::DocumentReader<RecordingShared> recording(unknown);
+        CHECK(!recording.root<std::shared_ptr<Foo>>());
+        CHECK(recording.error() == Clio::errc::invalid_data);
+
+        auto skipped = Test::make(Test::Members { { "id", Test::make(std::uint64_t(2)) }, { "value", Test::make(Test::Members { { "x", Test::make(std::int64_t(1)) } }) } });
+        Test::DocumentReader<RecordingShared> early(skipped);
+        early.root<std::shared_ptr<Foo>>();
+        CHECK(early.error() == Clio::errc::invalid_data);
+
+        // A reference to an object of another type
+        auto foo = std::make_shared<Foo>(Foo { 1 });
+        Test::DocumentReader<RecordingShared> reference(Test::make(Test::Members { { "ref", Test::make(std::uint64_t(0)) } }));
+        reference.identities().define(0, foo);
+        reference.root<std::shared_ptr<Outer>>();
+        CHECK(reference.error() == Clio::errc::invalid_data);
+    }
+
+    return Test::failures();
+}
@@ -0,0 +1,239 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/array.h>
+#include <clio/helper/map.h>
+#include <clio/helper/memory.h>
+#include <clio/helper/unordered_map.h>
+#include <clio/helper/vector.h>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Counts the allocations, for the steady state checks
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+// Without an in-place overload
+struct Foo {
+    int x = 0;
+    bool operator == (const Foo& other) const { return x == other.x; }
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Foo& v) {
+    auto object = s.object();
+    object.value("x", v.x);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Foo& v) {
+    auto object = d.object();
+    object.value("x", v.x);
+}
+
+// With one
+struct Bar {
+    std::string name;
+    std::vector<int> values;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Bar& v) {
+    auto object = s.object();
+    object.value("name", v.name);
+    object.value("values", v.values);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Bar& v, Clio::InPlace) {
+    auto object = d.object();
+    object.value("name", v.name);
+    object.value("values", v.values, Clio::in_place);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Bar& v) {
+    v = Bar();
+    deserialize(d, v, Clio::in_place);
+}
+
+struct Descending {
+    bool descending = false;
+    bool operator () (int a, int b) const { return descending ? a > b : a < b; }
+};
+
+// Reads the document written from source into target, in place
+template <typename Type, typename Target, typename ... Arguments>
+void decode(const Type& source, Target& target, Arguments ... args) {
+    Test::DocumentWriter<> writer;
+    writer.value(source, args...);
+    Test::DocumentReader<> reader(writer.document());
+    reader.value(target, args..., Clio::in_place);
+}
+
+// Decodes the document written from source into target a few times over, returns the allocations made by the last one
+template <typename Type, typename ... Arguments>
+std::size_t steady(const Type& source, Type& target, Arguments ... args) {
+    Test::DocumentWriter<> writer;
+    writer.value(source, args...);
+    Test::DocumentReader<> reader(writer.document());
+    reader.value(target, args..., Clio::in_place);
+    reader.value(target, args..., Clio::in_place);
+
+    std::size_t before = allocations;
+    reader.value(target, args..., Clio::in_place);
+    return allocations - before;
+}
+}
+
+int main() {
+    {
+        // Sequences keep their elements' capacity
+        std::vector<std::string> v { std::string(100, 'a'), std::string(100, 'b') };
+        const char* data = v[0].data();
+        decode(std::vector<std::string> { "short", "other", "third" }, v);
+        CHECK((v == std::vector<std::string> { "short", "other", "third" }));
+        CHECK(v[0].data() == data);
+
+        std::array<std::vector<int>, 2> fixed { std::vector<int>(50), std::vector<int>(50) };
+        const int* first = fixed[1].data();
+        decode(std::array<std::vector<int>, 2> { std::vector<int> { 1 }, std::vector<int> { 2, 3 } }, fixed);
+        CHECK(fixed[1] == (std::vector<int> { 2, 3 }) && fixed[1].data() == first);
+    }
+    {
+        // Maps keep their comparator, the entries that are present again and their values' capacity
+        std::map<int, std::string, Descending> v(Descending { true });
+        v[1] = std::string(100, 'x');
+        v[2] = "dropped";
+        const char* data = v[1].data();
+        const std::string* node = &v[1];
+
+        std::map<int, std::string> source { { 1, "one" }, { 3, "three" }, { 5, "five" } };
+        decode(source, v);
+        CHECK(v.key_comp().descending);
+        CHECK(v.size() == 3 && v.begin()->first == 5 && v.rbegin()->first == 1);
+        CHECK(v.count(2) == 0 && v[3] == "three");
+        CHECK(&v[1] == node && v[1] == "one" && v[1].data() == data);
+
+        decode(source, v, Clio::MapLayout::pairs);
+        CHECK(v.key_comp().descending && v.size() == 3 && &v[1] == node);
+    }
+    {
+        // Hash maps keep their bucket array as well
+        std::unordered_map<int, std::vector<int>> v;
+        for (int i = 0; i < 64; ++i) v[i] = std::vector<int>(32, i);
+        std::size_t buckets = v.bucket_count();
+
+        std::unordered_map<int, std::vector<int>> source;
+        for (int i = 0; i < 64; i += 2) source[i] = { i, i };
+        decode(source, v);
+        CHECK(v == source);
+        CHECK(v.bucket_count() == buckets);
+        CHECK(v.count(7) == 0 && v[8] == (std::vector<int> { 8, 8 }));
+
+        source[7] = { 7 };
+        decode(source, v);
+        CHECK(v == source && v.bucket_count() == buckets);
+    }
+    {
+        // Polymorphic allocators stay with the container
+        char storage[8192];
+        std::pmr::monotonic_buffer_resource resource(storage, sizeof(storage));
+        std::pmr::map<int, int> v(&resource);
+        v[1] = 10;
+        v[2] = 20;
+        decode(std::map<int, int> { { 2, 2 }, { 3, 3 } }, v);
+        CHECK(v.get_allocator().resource() == &resource);
+        CHECK(v.size() == 2 && v[2] == 2 && v[3] == 3);
+    }
+    {
+        // The tag goes only to elements that accept it, pointers included
+        std::vector<std::shared_ptr<Foo>> shared { std::make_shared<Foo>(Foo { 1 }) };
+        std::shared_ptr<Foo> kept = shared[0];
+        decode(std::vector<std::shared_ptr<Foo>> { std::make_shared<Foo>(Foo { 2 }), nullptr }, shared);
+        CHECK(shared.size() == 2 && shared[0]->x == 2 && !shared[1]);
+        CHECK(kept->x == 1);
+
+        std::vector<std::unique_ptr<Foo>> unique;
+        unique.push_back(std::make_unique<Foo>(Foo { 1 }));
+        std::vector<std::unique_ptr<Foo>> source;
+        source.push_back(std::make_unique<Foo>(Foo { 3 }));
+        decode(source, unique);
+        CHECK(unique.size() == 1 && unique[0]->x == 3);
+
+        std::map<int, std::vector<Foo>> nested { { 1, { Foo { 1 } } } };
+        decode(std::map<int, std::vector<Foo>> { { 1, { Foo { 4 }, Foo { 5 } } } }, nested);
+        CHECK(nested[1].size() == 2 && nested[1][1].x == 5);
+    }
+    {
+        // Existing unique pointees are read into
+        std::vector<std::unique_ptr<Bar>> v;
+        v.push_back(std::make_unique<Bar>(Bar { std::string(100, 'n'), std::vector<int>(100) }));
+        const Bar* pointee = v[0].get();
+        const int* values = v[0]->values.data();
+
+        std::vector<std::unique_ptr<Bar>> source;
+        source.push_back(std::make_unique<Bar>(Bar { "bar", { 1, 2, 3 } }));
+        source.push_back(nullptr);
+        decode(source, v);
+        CHECK(v.size() == 2 && !v[1]);
+        CHECK(v[0].get() == pointee && v[0]->name == "bar" && v[0]->values.data() == values && v[0]->values.size() == 3);
+
+        std::unique_ptr<Bar> empty;
+        decode(std::unique_ptr<Bar>(), v[0]);
+        CHECK(!v[0]);
+        decode(source[0], empty);
+        CHECK(empty && empty->name == "bar");
+    }
+    {
+        // Once warmed up, decoding the same shape of input allocates nothing, whatever the map layout
+        const std::string text(100, 't');
+        std::map<int, std::string> ordered { { 1, text }, { 2, text + text }, { 3, "short" } };
+        std::map<int, std::string> target;
+        CHECK(steady(ordered, target) == 0);
+        CHECK(steady(ordered, target, Clio::MapLayout::pairs) == 0);
+        CHECK(steady(ordered, target, Clio::MapLayout::columns) == 0);
+        CHECK(target == ordered);
+
+        std::unordered_map<int, std::vector<int>> hashed;
+        for (int i = 0; i < 64; ++i) hashed[i] = std::vector<int>(16, i);
+        std::unordered_map<int, std::vector<int>> other;
+        CHECK(steady(hashed, other) == 0);
+        CHECK(steady(hashed, other, Clio::MapLayout::columns) == 0);
+        CHECK(other == hashed);
+
+        std::map<std::string, std::map<int, std::string>> nested { { "a", ordered }, { "b", { { 7, text } } } };
+        std::map<std::string, std::map<int, std::string>> copy;
+        CHECK(steady(nested, copy) == 0);
+        CHECK(copy == nested);
+
+        std::vector<Bar> bars { Bar { text, { 1, 2, 3 } }, Bar { "bar", std::vector<int>(100) } };
+        std::vector<Bar> decoded;
+        CHECK(steady(bars, decoded) == 0);
+        CHECK(decoded.size() == 2 && decoded[0].name == text && decoded[1].values.size() == 100);
+    }
+
+    return Test::failures();
+}
@@ -0,0 +1,249 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include <clio/Serializer.h>
+#include <clio/Deserializer.h>
+#include <clio/KeyDictionary.h>
+#include <clio/helper/map.h>
+#include <clio/helper/vector.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// A token stream which carries keys as ids, with each key defined at its first occurrence
+namespace {
+struct Token {
+    enum Type { Object, Array, End, Define, Key, Integer, Text } type;
+    std::int64_t number = 0;    // The id for Define and Key
+    std::string text = {};
+};
+using Tokens = std::vector<Token>;
+
+class TokenWriter : public Clio::Serializer<TokenWriter> {
+    CLIO_SERIALIZER(TokenWriter)
+
+    Tokens tokens;
+    Clio::KeyDictionary dictionary;
+
+protected:
+    void write(int v) { tokens.push_back({ Token::Integer, v }); }
+    void write(const std::string& v) { tokens.push_back({ Token::Text, 0, v }); }
+
+    Clio::KeyDictionary& keyDictionary() { return dictionary; }
+    void defineKey(Clio::KeyDictionary::Id id, std::string_view key) { tokens.push_back({ Token::Define, id, std::string(key) }); }
+    void writeKey(Clio::KeyDictionary::Id id) { tokens.push_back({ Token::Key, id }); }
+
+    void beginObject() { tokens.push_back({ Token::Object }); }
+    void endObject() { tokens.push_back({ Token::End }); }
+    void beginArray() { tokens.push_back({ Token::Array }); }
+    void endArray() { tokens.push_back({ Token::End }); }
+};
+
+template <typename ErrorMode = Clio::ErrorMode::Throw>
+class TokenReader : public Clio::Deserializer<TokenReader<ErrorMode>> {
+    CLIO_DESERIALIZER(TokenReader)
+    using error_mode = ErrorMode;
+
+    explicit TokenReader(Tokens input) : tokens(std::move(input)) {}
+
+    Clio::KeyDictionary dictionary;
+
+protected:
+    void read(int& v) {
+        if (auto token = expect(Token::Integer)) v = static_cast<int>(token->number);
+    }
+    void read(std::string& v) {
+        if (auto token = expect(Token::Text)) v = token->text;
+    }
+
+    Clio::KeyDictionary& keyDictionary() { return dictionary; }
+    Clio::KeyDictionary::Id peekKey() {
+        return key(position);
+    }
+    bool hasKey(Clio::KeyDictionary::Id id) {
+        return id != Clio::KeyDictionary::npos && position < tokens.size() && key(position) == id;
+    }
+    void readKey(Clio::KeyDictionary::Id id) {
+        if (!hasKey(id)) return raise(Clio::errc::missing_key);
+        advance();
+    }
+
+    void beginObject() { expect(Token::Object); }
+    void endObject() { close(); }
+    void beginArray() { expect(Token::Array); }
+    void endArray() { close(); }
+
+    // The number of keys (or elements) until the end of the current object (or array)
+    std::size_t size() const {
+        bool object = tokens.at(position - 1).type == Token::Object;
+        std::size_t count = 0, depth = 0;
+        for (std::size_t i = position; i < tokens.size(); ++i) {
+            Token::Type type = tokens[i].type;
+            if (type == Token::End && !depth--) break;
+            if (!depth && (object ? type == Token::Define || type == Token::Key : type != Token::End)) count++;
+            if (type == Token::Object || type == Token::Array) depth++;
+        }
+        return count;
+    }
+
+private:
+    // Definitions are added to the dictionary as soon as they're reached, so the key can be resolved before it's read
+    void advance() {
+        if (++position >= tokens.size()) return;
+        const Token& token = tokens[position];
+        if (token.type == Token::Define && static_cast<std::size_t>(token.number) == dictionary.size()) dictionary.insert(token.text);
+    }
+
+    Clio::KeyDictionary::Id key(std::size_t i) const {
+        const Token& token = tokens.at(i);
+        return token.type == Token::Define || token.type == Token::Key ? static_cast<Clio::KeyDictionary::Id>(token.number) : Clio::KeyDictionary::npos;
+    }
+
+    // Skips what's left of the current object or array, the scope may be closed during unwinding
+    void close() {
+        for (std::size_t depth = 0; position < tokens.size(); advance()) {
+            Token::Type type = tokens[position].type;
+            if (type == Token::End && !depth--) break;
+            if (type == Token::Object || type == Token::Array) depth++;
+        }
+        advance();
+    }
+
+    const Token* expect(Token::Type type) {
+        if (position >= tokens.size() || tokens[position].type != type) {
+            raise(Clio::errc::type_mismatch);
+            return nullptr;
+        }
+        const Token* token = &tokens[position];
+        advance();
+        return token;
+    }
+
+    void raise(Clio::errc code) {
+        Clio::detail::fail(*this, code, [code] () { return Clio::make_error_code(code).message(); });
+    }
+
+    Tokens tokens;
+    std::size_t position = 0;
+};
+
+struct Point {
+    int x = 0, y = 0;
+    std::string label;
+
+    bool operator == (const Point& other) const { return x == other.x && y == other.y && label == other.label; }
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Point& p) {
+    auto object = s.object();
+    object.value("x", p.x);
+    object.value("y", p.y);
+    object.value("label", p.label);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Point& p) {
+    auto object = d.object();
+    object.value("x", p.x);
+    object.value("y", p.y);
+    object.value("label", p.label);
+}
+
+// Keys in local arrays of the same size, which may be placed at the same address
+[[gnu::noinline]] Clio::KeyDictionary::Id alpha(Clio::KeyDictionary& dictionary) {
+    const char key[] = "alpha";
+    return dictionary.insert(key).first;
+}
+
+[[gnu::noinline]] Clio::KeyDictionary::Id gamma(Clio::KeyDictionary& dictionary) {
+    const char key[] = "gamma";
+    return dictionary.insert(key).first;
+}
+
+std::size_t count(const Tokens& tokens, Token::Type type) {
+    return std::count_if(tokens.begin(), tokens.end(), [type] (const Token& token) { return token.type == type; });
+}
+}
+
+int main() {
+    {
+        // Literal keys are found by address, other keys with the same text still get the same id
+        Clio::KeyDictionary dictionary;
+        CHECK(dictionary.find("alpha") == Clio::KeyDictionary::npos);
+        CHECK((dictionary.insert("alpha") == std::pair<Clio::KeyDictionary::Id, bool>(0, true)));
+        CHECK((dictionary.insert("alpha") == std::pair<Clio::KeyDictionary::Id, bool>(0, false)));
+        CHECK(dictionary.find("alpha") == 0);
+        CHECK(dictionary.find(std::string("alpha")) == 0);
+        CHECK(dictionary.insert(std::string("beta")).first == 1);
+        CHECK(dictionary.find("beta") == 1);
+
+        char buffer[] = "beta";
+        CHECK(dictionary.find(buffer) == 1);
+        buffer[0] = 'z';
+        CHECK(dictionary.find(buffer) == Clio::KeyDictionary::npos);
+
+        CHECK(dictionary.contains(1) && !dictionary.contains(2));
+        dictionary.clear();
+        CHECK(dictionary.find("alpha") == Clio::KeyDictionary::npos);
+        CHECK(dictionary.insert("beta").first == 0);
+    }
+    {
+        // The address of a cached key may be taken over by a different one
+        Clio::KeyDictionary dictionary;
+        CHECK(alpha(dictionary) == 0);
+        CHECK(gamma(dictionary) == 1);
+        CHECK(alpha(dictionary) == 0);
+        CHECK(dictionary.size() == 2);
+
+        char buffer[] = "delta";
+        const char (&key)[sizeof(buffer)] = buffer;
+        CHECK(dictionary.insert(key).first == 2);
+        std::memcpy(buffer, "omega", sizeof(buffer));
+        CHECK(dictionary.find(key) == Clio::KeyDictionary::npos);
+        CHECK(dictionary.insert(key).first == 3);
+        std::memcpy(buffer, "gamma", sizeof(buffer));
+        CHECK(dictionary.find(key) == 1);
+        CHECK(dictionary.size() == 4);
+    }
+    {
+        // Each key is defined once per stream, and the stream reads back
+        std::vector<Point> points { { 1, 2, "a" }, { 3, 4, "b" }, { 5, 6, "c" } };
+        std::map<std::string, int> counts { { "one", 1 }, { "two", 2 } };
+        TokenWriter writer;
+        writer.value(points);
+        writer.value(counts);
+        writer.value(counts);
+        CHECK(count(writer.tokens, Token::Define) == 5);
+        CHECK(count(writer.tokens, Token::Key) == 3 * 2 + 2);
+
+        TokenReader<> reader(writer.tokens);
+        CHECK(reader.root<std::vector<Point>>() == points);
+        CHECK((reader.root<std::map<std::string, int>>() == counts));
+        CHECK((reader.root<std::map<std::string, int>>() == counts));
+        CHECK(reader.dictionary.size() == 5);
+    }
+    {
+        // An id that was never defined is reported, not thrown as std::out_of_range in the recording mode
+        Tokens tokens { { Token::Object }, { Token::Key, 7 }, { Token::Integer, 1 }, { Token::End } };
+        TokenReader<> throwing(tokens);
+        CHECK_THROWS((throwing.root<std::map<std::string, int>>()));
+
+        TokenReader<Clio::ErrorMode::Record> recording(tokens);
+        CHECK_NOTHROW((recording.root<std::map<std::string, int>>()));
+        CHECK(recording.error() == Clio::errc::invalid_data);
+    }
+    {
+        // Once failed, the keys that follow aren't resolved
+        Tokens tokens { { Token::Object }, { Token::Define, 0, "a" }, { Token::Text, 0, "nan" }, { Token::Key, 5 }, { Token::Integer, 1 }, { Token::End } };
+        TokenReader<Clio::ErrorMode::Record> reader(tokens);
+        CHECK_NOTHROW((reader.root<std::map<std::string, int>>()));
+        CHECK(reader.error() == Clio::errc::type_mismatch);
+    }
+
+    return Test::failures();
+}
@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/map.h>
+#include <clio/helper/unordered_map.h>
+#include <clio/helper/vector.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace {
+struct PairsByDefault : Test::Options {
+    using map_layout = Clio::MapLayout::Pairs;
+};
+
+template <typename Settings = Test::Options, typename Type, typename ... Arguments>
+std::string json(const Type& v, Arguments&& ... args) {
+    Test::DocumentWriter<Settings> writer;
+    writer.value(v, std::forward<Arguments>(args)...);
+    return writer.json();
+}
+
+template <typename Type>
+std::shared_ptr<Test::Value> array(std::initializer_list<Type> items) {
+    Test::Elements elements;
+    for (auto& item : items) elements.push_back(Test::make(item));
+    return Test::make(std::move(elements));
+}
+
+std::shared_ptr<Test::Value> array(std::initializer_list<std::shared_ptr<Test::Value>> items) {
+    return Test::make(Test::Elements(items));
+}
+
+// Extended functors. This one writes the whole entry as an object of its own, as the Objects layout expects
+struct WholeEntry {
+    template <typename Interface>
+    std::enable_if_t<Clio::is_serializer_v<Interface>> operator () (Interface& s, const int& key, const std::string& item) const {
+        auto object = s.object();
+        object.value("id", key);
+        object.value("name", item);
+    }
+
+    template <typename Interface>
+    std::enable_if_t<Clio::is_deserializer_v<Interface>> operator () (Interface& d, int& key, std::string& item) const {
+        auto object = d.object();
+        object.value("id", key);
+        object.value("name", item);
+    }
+};
+
+// This one writes the item only, prefixed with the key, as the other layouts expect
+struct ItemOnly {
+    template <typename Interface>
+    std::enable_if_t<Clio::is_serializer_v<Interface>> operator () (Interface& s, const int& key, const std::string& item) const {
+        s.value(std::to_string(key) + ':' + item);
+    }
+
+    template <typename Interface>
+    std::enable_if_t<Clio::is_deserializer_v<Interface>> operator () (Interface& d, const int& key, std::string& item) const {
+        std::string text;
+        d.value(text);
+        std::string prefix = std::to_string(key) + ':';
+        item = text.compare(0, prefix.size(), prefix) == 0 ? text.substr(prefix.size()) : "?";
+    }
+};
+
+// Checks the malformed document is rejected in both error modes, with the given code when it's recorded
+template <typename Type, typename ... Arguments>
+void rejects(const std::shared_ptr<Test::Value>& document, Clio::errc code, Arguments ... args) {
+    Test::DocumentReader<> throwing(document);
+    CHECK_THROWS(throwing.root<Type>(args...));
+
+    Test::DocumentReader<Test::Recording> recording(document);
+    CHECK_NOTHROW(recording.root<Type>(args...));
+    CHECK(recording.error() == code);
+}
+}
+
+int main() {
+    using Map = std::map<int, std::string>;
+    const Map map { { 1, "one" }, { 2, "two" }, { 3, "three" } };
+
+    // The layouts as written
+    CHECK(json(map) == R"([{"key":1,"value":"one"},{"key":2,"value":"two"},{"key":3,"value":"three"}])");
+    CHECK(json(map, Clio::MapLayout::pairs) == R"([[1,"one"],[2,"two"],[3,"three"]])");
+    CHECK(json(map, Clio::MapLayout::columns) == R"([[1,2,3],["one","two","three"]])");
+    CHECK(json<PairsByDefault>(map) == json(map, Clio::MapLayout::pairs));
+    CHECK(json<PairsByDefault>(map, Clio::MapLayout::objects) == json(map));
+    CHECK((json(std::map<std::string, int> { { "a", 1 }, { "b", 2 } }) == R"({"a":1,"b":2})"));
+
+    // Round trips
+    CHECK(Test::roundtrip(map) == map);
+    CHECK(Test::roundtrip(map, Clio::MapLayout::pairs) == map);
+    CHECK(Test::roundtrip(map, Clio::MapLayout::columns) == map);
+    CHECK((Test::roundtrip<Map, PairsByDefault>(map) == map));
+    CHECK(Test::roundtrip(Map(), Clio::MapLayout::pairs).empty());
+    CHECK(Test::roundtrip(Map(), Clio::MapLayout::columns).empty());
+    {
+        std::unordered_map<int, std::vector<int>> nested { { 1, { 1, 2 } }, { 5, {} }, { -3, { 7 } } };
+        CHECK(Test::roundtrip(nested) == nested);
+        CHECK(Test::roundtrip(nested, Clio::MapLayout::pairs) == nested);
+        CHECK(Test::roundtrip(nested, Clio::MapLayout::columns) == nested);
+    }
+    {
+        std::map<int, std::map<int, int>> nested { { 1, { { 2, 3 } } }, { 4, {} } };
+        CHECK(Test::roundtrip(nested, Clio::MapLayout::pairs) == nested);
+        CHECK((Test::roundtrip<decltype(nested), PairsByDefault>(nested) == nested));
+    }
+
+    // The extended functor writes the whole entry under Objects, the item only under the other layouts
+    CHECK(json(map, WholeEntry()) == R"([{"id":1,"name":"one"},{"id":2,"name":"two"},{"id":3,"name":"three"}])");
+    CHECK(Test::roundtrip(map, WholeEntry()) == map);
+    CHECK(json(map, Clio::MapLayout::pairs, ItemOnly()) == R"([[1,"1:one"],[2,"2:two"],[3,"3:three"]])");
+    CHECK(json(map, Clio::MapLayout::columns, ItemOnly()) == R"([[1,2,3],["1:one","2:two","3:three"]])");
+    CHECK(Test::roundtrip(map, Clio::MapLayout::pairs, ItemOnly()) == map);
+    CHECK(Test::roundtrip(map, Clio::MapLayout::columns, ItemOnly()) == map);
+    CHECK((Test::roundtrip<Map, PairsByDefault>(map, ItemOnly()) == map));
+    CHECK((json(std::map<std::string, std::string> { { "a", "x" } }, [] (auto& s, const std::string& key, const std::string& item) { s.value(key + item); }) == R"({"a":"ax"})"));
+    // Under Objects the same item-only functor is handed the entry, and the key is left to it
+    CHECK(json(map, ItemOnly()) == R"(["1:one","2:two","3:three"])");
+    CHECK(json<PairsByDefault>(map, ItemOnly()) != json(map, ItemOnly()));
+
+    // Malformed entries
+    rejects<Map>(array({ array({ Test::make(std::int64_t(1)), Test::make(std::string("one")), Test::make(nullptr) }) }), Clio::errc::size_mismatch, Clio::MapLayout::pairs);
+    rejects<Map>(array({ array({ Test::make(std::int64_t(1)) }) }), Clio::errc::size_mismatch, Clio::MapLayout::pairs);
+    rejects<Map>(array({ array<std::int64_t>({ 1, 2 }), array<std::string>({ "one" }) }), Clio::errc::size_mismatch, Clio::MapLayout::columns);
+    rejects<Map>(array({ array<std::int64_t>({ 1, 2 }) }), Clio::errc::size_mismatch, Clio::MapLayout::columns);
+    rejects<Map>(array({ array<std::int64_t>({ 1 }), array<std::int64_t>({ 1 }) }), Clio::errc::type_mismatch, Clio::MapLayout::columns);
+    rejects<Map>(array<std::int64_t>({ 1, 2 }), Clio::errc::type_mismatch);
+    {
+        Test::Members entry { { "key", Test::make(std::int64_t(1)) } };
+        rejects<Map>(array({ Test::make(entry) }), Clio::errc::missing_key);
+    }
+
+    return Test::failures();
+}
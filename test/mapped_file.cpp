@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include <clio/MappedFile.h>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+namespace {
+struct File {
+    File(const std::string& content) {
+        std::ofstream(path, std::ios::binary) << content;
+    }
+    ~File() {
+        std::remove(path.c_str());
+    }
+    std::string path = "clio_mapped_file.bin";
+};
+}
+
+int main() {
+    {
+        File file("Hello, mapped world");
+        Clio::MappedFile mapped(file.path);
+        CHECK(mapped.size() == 19);
+        CHECK(!mapped.empty());
+        CHECK(mapped.view() == "Hello, mapped world");
+
+        Clio::MappedFile moved(std::move(mapped));
+        CHECK(std::string_view(moved) == "Hello, mapped world");
+        CHECK(mapped.empty());
+    }
+    {
+        File file("");
+        Clio::MappedFile mapped(file.path, Clio::MappedFile::Access::Random);
+        CHECK(mapped.empty());
+        CHECK(mapped.view().empty());
+    }
+    CHECK_THROWS(Clio::MappedFile("clio_no_such_file.bin"));
+
+    return Test::failures();
+}
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/vector.h>
+#include <clio/helper/array.h>
+#include <clio/helper/packed.h>
+#include <array>
+#include <limits>
+
+namespace {
+template <typename Type, typename Codec>
+bool same(const std::vector<Type>& v, Codec codec) {
+    return Test::roundtrip(v, codec) == v;
+}
+
+template <typename Settings>
+std::vector<int> decode(Test::DocumentReader<Settings>& reader) {
+    return reader.template root<std::vector<int>>(Clio::Packed::delta);
+}
+
+std::shared_ptr<Test::Value> blob(const std::string& bytes) {
+    return Test::make(Test::Bytes { bytes });
+}
+}
+
+int main() {
+    // Round trips
+    CHECK(same(std::vector<int>(), Clio::Packed::delta));
+    CHECK(same(std::vector<int>(), Clio::Packed::varint));
+    CHECK(same(std::vector<int> { 42 }, Clio::Packed::delta));
+    CHECK(same(std::vector<int> { -7, 0, 7, 1000, -1000 }, Clio::Packed::varint));
+    CHECK(same(std::vector<int> { 5, 5, 5, 5, 5, 5 }, Clio::Packed::delta));
+    CHECK(same(std::vector<std::int8_t> { -128, 127, 0, -1, 1 }, Clio::Packed::delta));
+    CHECK(same(std::vector<std::int64_t> { std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max(), 0 }, Clio::Packed::delta));
+    CHECK(same(std::vector<std::uint64_t> { 0, std::numeric_limits<std::uint64_t>::max(), 1 }, Clio::Packed::varint));
+    {
+        std::vector<std::uint32_t> timestamps;
+        for (std::uint32_t i = 0; i < 1000; ++i) timestamps.push_back(1700000000 + i * 3 + i % 2);
+        CHECK(same(timestamps, Clio::Packed::delta));
+        CHECK(same(timestamps, Clio::Packed::varint));
+    }
+    {
+        std::array<short, 4> fixed { 1, -2, 3, -4 };
+        CHECK(Test::roundtrip(fixed, Clio::Packed::delta) == fixed);
+
+        Test::DocumentWriter<> writer;
+        writer.value(std::vector<short> { 1, 2, 3 }, Clio::Packed::delta);
+        Test::DocumentReader<> reader(writer.document());
+        CHECK_THROWS((reader.root<std::array<short, 4>>(Clio::Packed::delta)));
+    }
+
+    // Malformed blobs are reported, in both error modes, without allocating for the claimed size
+    const std::string huge("\x01\x80\x80\x80\x80\x80\x20\x00\x00\x00", 10);     // Delta, 2^40 equal elements
+    const std::string limit("\x01\x81\x80\x80\x08\x00\x00\x00", 8);             // Delta, 2^24 + 1 equal elements
+    const std::string truncated("\x01\x08\x00\x00\x07\xFF", 6);                 // Delta, 8 elements of 7 bits in a single byte
+    const std::string width("\x01\x02\x00\x00\x21\x00", 6);                     // Delta, 33 bit wide deltas of 32 bit integers
+    const std::string codec("\x07\x01\x00", 3);
+    const std::string varints("\x00\x05\x02\x04", 4);                           // Varint, 5 elements in 2 bytes
+    const std::string empty;
+    for (auto& bytes : { huge, limit, truncated, width, codec, varints, empty }) {
+        Test::DocumentReader<> throwing(blob(bytes));
+        CHECK_THROWS(decode(throwing));
+
+        Test::DocumentReader<Test::Recording> recording(blob(bytes));
+        CHECK_NOTHROW(decode(recording));
+        CHECK(recording.failed());
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(blob(huge));
+        CHECK(decode(reader).empty());
+        CHECK(reader.error() == Clio::errc::invalid_data);
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(blob(truncated));
+        decode(reader);
+        CHECK(reader.error() == Clio::errc::unexpected_end);
+    }
+    {
+        // A sequence at the limit still decodes
+        const std::string equal("\x01\x80\x80\x80\x08\x03\x00\x00", 8);
+        Test::DocumentReader<> reader(blob(equal));
+        auto v = decode(reader);
+        CHECK(v.size() == std::size_t(1) << 24);
+        CHECK(v.front() == -2 && v.back() == -2);
+    }
+
+    return Test::failures();
+}
@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/vector.h>
+#include <string>
+#include <vector>
+
+int main() {
+    std::vector<int> keys;
+    for (int i = 0; i < 100; ++i) keys.push_back(i * 2);
+    Test::DocumentWriter<> writer;
+    writer.value(keys);
+    {
+        Test::DocumentReader<> reader(writer.document());
+        auto array = reader.array();
+        CHECK(array.at<int>(42) == 84);
+        CHECK(array.at<int>(0) == 0);
+        CHECK(array.at<int>(99) == 198);
+        CHECK(array.lower_bound<int>(84) == 42);
+        CHECK(array.lower_bound<int>(85) == 43);
+        CHECK(array.lower_bound<int>(-1) == 0);
+        CHECK(array.lower_bound<int>(1000) == 100);
+
+        // Reading continues from the sought element
+        array.seek(98);
+        int a = 0, b = 0;
+        array.value(a);
+        array.value(b);
+        CHECK(a == 196 && b == 198);
+
+        CHECK_THROWS(array.at<int>(100));
+        CHECK_THROWS(array.seek(1000));
+    }
+    {
+        Test::DocumentReader<Test::Recording> reader(writer.document());
+        auto array = reader.array();
+        CHECK(array.at<int>(7) == 14);
+        CHECK_NOTHROW(array.at<int>(100));
+        CHECK(reader.error() == Clio::errc::out_of_range);
+        // Nothing more is read once failed
+        CHECK(array.at<int>(7) == 0);
+        CHECK(array.size() == 0);
+    }
+    {
+        // The search stops at an element that can't be read
+        Test::DocumentWriter<> mixed;
+        mixed.value(std::vector<int> { 1, 3, 5, 7, 9 });
+        std::get<Test::Elements>(mixed.document()->data)[2] = Test::make(std::string("five"));
+        Test::DocumentReader<Test::Recording> reader(mixed.document());
+        auto array = reader.array();
+        CHECK(array.lower_bound<int>(8) == 5);
+        CHECK(reader.error() == Clio::errc::type_mismatch);
+    }
+    {
+        // Empty arrays have no elements to seek to
+        Test::DocumentWriter<> empty;
+        empty.value(std::vector<int>());
+        Test::DocumentReader<Test::Recording> reader(empty.document());
+        auto array = reader.array();
+        CHECK(array.lower_bound<int>(5) == 0);
+        array.seek(0);
+        CHECK(reader.error() == Clio::errc::out_of_range);
+    }
+
+    return Test::failures();
+}
@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include <clio/Serializer.h>
+#include <clio/SegmentBuffer.h>
+#include <clio/helper/vector.h>
+#include <clio/helper/packed.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+// Bytes owned by the application, which keeps them until the output is written out
+struct Attachment {
+    std::string_view bytes;
+};
+
+// Writes values as "<size>:<bytes>", strings (which may be the helpers' scratch buffers) are copied and only attachments
+// are referenced
+class SegmentWriter : public Clio::Serializer<SegmentWriter> {
+    CLIO_SERIALIZER(SegmentWriter)
+
+    explicit SegmentWriter(std::size_t threshold) : output(threshold) {}
+
+    Clio::SegmentBuffer output;
+
+protected:
+    void write(const std::string& v) {
+        output.append(std::to_string(v.size()) + ':');
+        output.append(v);
+    }
+    void write(const Attachment& v) {
+        output.append(std::to_string(v.bytes.size()) + ':');
+        output.reference(v.bytes);
+    }
+    void writeKey(std::string_view key) {
+        output.append(key);
+        output.append('=');
+    }
+
+    void beginObject() { output.append('{'); }
+    void endObject() { output.append('}'); }
+    void beginArray() { output.append('['); }
+    void endArray() { output.append(']'); }
+    void beginBlob() {}
+    void endBlob() {}
+};
+
+struct Message {
+    std::vector<int> first, second;
+    Attachment payload;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Message& v) {
+    auto object = s.object();
+    object.value("first", v.first, Clio::Packed::varint);
+    object.value("second", v.second, Clio::Packed::varint);
+    object.value("payload", v.payload);
+}
+
+std::string gather(const std::vector<iovec>& vectors) {
+    std::string result;
+    for (auto& vector : vectors) result.append(static_cast<const char*>(vector.iov_base), vector.iov_len);
+    return result;
+}
+}
+
+int main() {
+    const std::string large(64, 'L'), other(32, 'R');
+    {
+        // Small writes are coalesced, large ones referenced in place
+        Clio::SegmentBuffer buffer(32);
+        buffer.append("ab");
+        buffer.append('c');
+        buffer.reference(large);
+        buffer.reference("short");
+        buffer.append("de");
+        buffer.reference(other);
+        CHECK(buffer.size() == 3 + 64 + 7 + 32);
+
+        auto& vectors = buffer.iovecs();
+        CHECK(vectors.size() == 4);
+        CHECK(vectors[1].iov_base == large.data() && vectors[3].iov_base == other.data());
+        CHECK(gather(vectors) == "abc" + large + "shortde" + other);
+        CHECK(buffer.flatten() == gather(vectors));
+    }
+    {
+        // Partial writes, across and exactly at segment boundaries
+        Clio::SegmentBuffer buffer(32);
+        buffer.append("abc");
+        buffer.reference(large);
+        buffer.append("xyz");
+        const std::string all = "abc" + large + "xyz";
+
+        buffer.consume(2);
+        CHECK(buffer.size() == all.size() - 2 && buffer.flatten() == all.substr(2));
+        CHECK(buffer.iovecs().size() == 3 && buffer.iovecs()[0].iov_len == 1);
+
+        buffer.consume(1 + 10);
+        CHECK(buffer.flatten() == all.substr(13));
+        CHECK(buffer.iovecs().size() == 2 && buffer.iovecs()[0].iov_base == large.data() + 10);
+
+        buffer.consume(54);
+        CHECK(buffer.flatten() == "xyz" && buffer.iovecs().size() == 1);
+
+        buffer.consume(3);
+        CHECK(buffer.empty() && buffer.iovecs().empty());
+
+        // Fully consumed, the buffer starts over
+        buffer.append("next");
+        CHECK(buffer.flatten() == "next" && buffer.iovecs().size() == 1);
+    }
+    {
+        // At most limit vectors, the rest are returned once the first ones are consumed
+        Clio::SegmentBuffer buffer(1);
+        std::vector<std::string> parts;
+        for (char c = 'a'; c < 'a' + 5; ++c) parts.emplace_back(3, c);
+        for (auto& part : parts) buffer.reference(part);
+
+        auto& vectors = buffer.iovecs(2);
+        CHECK(vectors.size() == 2 && gather(vectors) == "aaabbb");
+        buffer.consume(4);
+        CHECK(gather(buffer.iovecs(2)) == "bbccc");
+        CHECK(buffer.iovecs(0).empty());
+        CHECK(buffer.iovecs().size() == 4);
+        buffer.consume(100);
+        CHECK(buffer.empty());
+    }
+    {
+        // The packed helper reuses its scratch string for each sequence, so the backend copies what it's given as a
+        // std::string, only the attachment's bytes are referenced
+        std::vector<int> first(100), second(100);
+        for (int i = 0; i < 100; ++i) {
+            first[std::size_t(i)] = i;
+            second[std::size_t(i)] = -i * 1000;
+        }
+        std::string bytes(1000, 'P');
+        SegmentWriter writer(16);
+        writer.value(Message { first, second, Attachment { bytes } });
+
+        std::string expected;
+        for (auto& sequence : { first, second }) {
+            std::string packed;
+            Clio::detail::encode_packed(packed, sequence, Clio::detail::PackedCodec::Varint);
+            expected += std::string(expected.empty() ? "{first=" : "second=") + std::to_string(packed.size()) + ':' + packed;
+        }
+        expected += "payload=1000:" + bytes + '}';
+        CHECK(writer.output.flatten() == expected);
+
+        auto& vectors = writer.output.iovecs();
+        CHECK(vectors.size() == 3 && vectors[1].iov_base == bytes.data());
+    }
+
+    return Test::failures();
+}
@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/helper/vector.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+struct Point {
+    int x = 0, y = 0;
+    std::string label;
+
+    bool operator == (const Point& other) const { return x == other.x && y == other.y && label == other.label; }
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_serializer_v<Interface>> serialize(Interface& s, const Point& p) {
+    auto object = s.object();
+    object.value("x", p.x);
+    object.value("y", p.y);
+    object.value("label", p.label);
+}
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Point& p) {
+    auto object = d.object(Clio::Deserialization::shape<Point>());
+    object.value("x", p.x);
+    object.value("y", p.y);
+    object.value("label", p.label);
+}
+
+// Read with keys that aren't literals, one of them at the same address each time
+struct Named {
+    int x = 0, y = 0;
+};
+
+template <typename Interface>
+std::enable_if_t<Clio::is_deserializer_v<Interface>> deserialize(Interface& d, Named& v) {
+    static const std::string x = "x";
+    auto object = d.object(Clio::Deserialization::shape<Named>());
+    object.value(x, v.x);
+    object.value(std::string("y"), v.y);
+}
+
+const std::vector<Point> points { { 1, 2, "a" }, { 3, 4, "b" }, { 5, 6, "c" }, { 7, 8, "d" } };
+
+std::shared_ptr<Test::Value> document() {
+    Clio::Deserialization::shape<Point>() = Clio::Deserialization::Shape();
+    Test::DocumentWriter<> writer;
+    writer.value(points);
+    return writer.document();
+}
+
+Test::Members& members(const std::shared_ptr<Test::Value>& document, std::size_t index) {
+    return std::get<Test::Members>(std::get<Test::Elements>(document->data).at(index)->data);
+}
+}
+
+int main() {
+    {
+        // Nothing is predicted for the first object, the fields of the ones that follow are found where predicted
+        Test::DocumentReader<> reader(document());
+        CHECK(reader.root<std::vector<Point>>() == points);
+        CHECK(reader.hints().predicted == 3 * 3);
+        CHECK(reader.hints().hits == 3 * 3);
+    }
+    {
+        // A reordered object misses, and the new order is learned
+        auto tree = document();
+        for (std::size_t i : { 1, 2, 3 }) std::reverse(members(tree, i).begin(), members(tree, i).end());
+        Test::DocumentReader<> reader(tree);
+        CHECK(reader.root<std::vector<Point>>() == points);
+        CHECK(reader.hints().predicted == 3 * 3);
+        CHECK(reader.hints().hits == 1 + 3 + 3);
+    }
+    {
+        // A missing key is reported as usual, with or without a prediction
+        auto tree = document();
+        auto& second = members(tree, 1);
+        second.erase(second.begin() + 1);
+        Test::DocumentReader<> throwing(tree);
+        CHECK_THROWS(throwing.root<std::vector<Point>>());
+
+        auto valid = document();
+        Test::DocumentReader<Test::Recording> recording(tree);
+        CHECK_NOTHROW(recording.root<std::vector<Point>>());
+        CHECK(recording.error() == Clio::errc::missing_key);
+
+        // The failed lookup isn't learned, the shape still predicts each field of the next objects
+        Test::DocumentReader<> reader(valid);
+        CHECK(reader.root<std::vector<Point>>() == points);
+        CHECK(reader.hints().predicted == 4 * 3);
+        CHECK(reader.hints().hits == 4 * 3);
+    }
+    {
+        // Keys that aren't literals are never predicted, even if found at the same address
+        Test::DocumentReader<> reader(document());
+        auto v = reader.root<std::vector<Named>>();
+        CHECK(v.size() == points.size() && v.back().x == 7 && v.back().y == 8);
+        CHECK(reader.hints().predicted == 0);
+    }
+
+    return Test::failures();
+}
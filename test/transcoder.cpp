@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: © 2023 Konstantin Shegunov <kshegunov@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "Test.h"
+#include "Document.h"
+#include <clio/Transcoder.h>
+#include <string>
+
+namespace {
+std::shared_ptr<Test::Value> nested(std::size_t depth, std::shared_ptr<Test::Value> leaf) {
+    for (std::size_t i = 0; i < depth; ++i) leaf = Test::make(Test::Elements { leaf });
+    return leaf;
+}
+
+template <typename Settings = Test::Options>
+std::string transcode(const std::shared_ptr<Test::Value>& document, std::size_t depth = Clio::Transcoder<Test::DocumentReader<Settings>, Test::DocumentWriter<>>::defaultDepth) {
+    Test::DocumentReader<Settings> reader(document);
+    Test::DocumentWriter<> writer;
+    Clio::transcode(reader, writer, depth);
+    return writer.json();
+}
+}
+
+int main() {
+    {
+        Test::Members members {
+            { "null", Test::make(nullptr) },
+            { "bool", Test::make(true) },
+            { "negative", Test::make(std::int64_t(-5)) },
+            { "large", Test::make(std::uint64_t(1) << 63) },
+            { "real", Test::make(2.5) },
+            { "text", Test::make(std::string("hello")) },
+            { "bytes", Test::make(Test::Bytes { std::string("\x00\x01\x02", 3) }) },
+            { "list", Test::make(Test::Elements { Test::make(std::int64_t(1)), Test::make(Test::Members()), Test::make(Test::Elements()) }) },
+        };
+        auto document = Test::make(members);
+
+        Test::DocumentReader<> reader(document);
+        Test::DocumentWriter<> writer;
+        Clio::transcode(reader, writer);
+        CHECK(writer.json() == Test::json(*document));
+
+        // Blobs arrive as blobs
+        auto& copied = std::get<Test::Members>(writer.document()->data);
+        CHECK(std::get<Test::Bytes>(copied[6].second->data).data == std::string("\x00\x01\x02", 3));
+        CHECK(std::get<std::uint64_t>(copied[3].second->data) == std::uint64_t(1) << 63);
+    }
+    {
+        // Scalars at the top level
+        CHECK(transcode(Test::make(std::string("root"))) == "\"root\"");
+        CHECK(transcode(Test::make(std::int64_t(7))) == "7");
+    }
+    {
+        // Nesting is limited
+        CHECK(transcode(nested(10, Test::make(true)), 10) == "[[[[[[[[[[true]]]]]]]]]]");
+        CHECK_THROWS(transcode(nested(11, Test::make(true)), 10));
+        CHECK_NOTHROW(transcode(nested(200, Test::make(true))));
+        CHECK_THROWS(transcode(nested(1000, Test::make(true))));
+
+        // and nothing is written once the source has failed
+        auto document = Test::make(Test::Elements { Test::make(std::int64_t(1)), nested(5, Test::make(true)), Test::make(std::int64_t(2)) });
+        Test::DocumentReader<Test::Recording> reader(document);
+        Test::DocumentWriter<> writer;
+        Clio::transcode(reader, writer, 4);
+        CHECK(reader.error() == Clio::errc::invalid_data);
+        CHECK(writer.json() == "[1,[[[]]]]");
+    }
+
+    return Test::failures();
+}